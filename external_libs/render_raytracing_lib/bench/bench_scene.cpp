@@ -0,0 +1,141 @@
+#include "bench_scene.hpp"
+#include <util_raytracing/object.hpp>
+#include <util_raytracing/mesh.hpp>
+#include <util_raytracing/camera.hpp>
+#include <util_raytracing/light.hpp>
+#include <util_raytracing/scene.hpp>
+#include <util_raytracing/shader.hpp>
+#include <util_raytracing.hpp>
+#include <util_image.hpp>
+#include <util_image_buffer.hpp>
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <mathutil/uvec.h>
+#include <mathutil/uquat.h>
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+static constexpr float PATCH_SIZE = 200.f;
+static constexpr float PATCH_SPACING = PATCH_SIZE * 1.25f;
+static constexpr float WAVE_AMPLITUDE = 12.f;
+
+// Square patch of n*n quads, displaced by a sine wave. Every object gets a different phase, so no two meshes are identical.
+static unirender::PMesh create_wave_patch(const std::string &name, uint32_t numTriangles, float phase)
+{
+	auto n = static_cast<uint32_t>(std::ceil(std::sqrt(std::max(numTriangles, 2u) / 2.f)));
+	auto numVerts = (n + 1) * (n + 1);
+	auto numTris = n * n * 2;
+	auto mesh = unirender::Mesh::Create(name, numVerts, numTris, unirender::Mesh::Flags::None);
+
+	auto freq = 2.f * std::numbers::pi_v<float> * 3.f / PATCH_SIZE;
+	for(uint32_t z = 0; z <= n; ++z) {
+		for(uint32_t x = 0; x <= n; ++x) {
+			auto u = x / static_cast<float>(n);
+			auto v = z / static_cast<float>(n);
+			auto px = (u - 0.5f) * PATCH_SIZE;
+			auto pz = (v - 0.5f) * PATCH_SIZE;
+			auto sx = std::sin(px * freq + phase);
+			auto cz = std::cos(pz * freq + phase);
+			auto py = WAVE_AMPLITUDE * sx * cz;
+			auto dx = WAVE_AMPLITUDE * freq * std::cos(px * freq + phase) * cz;
+			auto dz = -WAVE_AMPLITUDE * freq * sx * std::sin(pz * freq + phase);
+			auto normal = uvec::get_normal(Vector3 {-dx, 1.f, -dz});
+			auto tangent = uvec::get_normal(Vector3 {1.f, dx, 0.f});
+			mesh->AddVertex(Vector3 {px, py, pz}, normal, Vector4 {tangent.x, tangent.y, tangent.z, 1.f}, ::Vector2 {u, v});
+		}
+	}
+	for(uint32_t z = 0; z < n; ++z) {
+		for(uint32_t x = 0; x < n; ++x) {
+			auto i0 = z * (n + 1) + x;
+			auto i1 = i0 + 1;
+			auto i2 = i0 + (n + 1);
+			auto i3 = i2 + 1;
+			mesh->AddTriangle(i0, i2, i1, 0);
+			mesh->AddTriangle(i1, i2, i3, 0);
+		}
+	}
+	return mesh;
+}
+
+static bool write_checker_texture(const std::string &fileName, uint32_t size)
+{
+	auto imgBuf = uimg::ImageBuffer::Create(size, size, uimg::Format::RGBA_LDR);
+	auto *data = static_cast<uint8_t *>(imgBuf->GetData());
+	auto cellSize = std::max(size / 16u, 1u);
+	for(uint32_t y = 0; y < size; ++y) {
+		for(uint32_t x = 0; x < size; ++x) {
+			auto cx = x / cellSize;
+			auto cy = y / cellSize;
+			auto *px = data + (static_cast<size_t>(y) * size + x) * 4;
+			auto even = ((cx + cy) % 2) == 0;
+			px[0] = even ? 230 : static_cast<uint8_t>(40 + (cx * 13) % 120);
+			px[1] = even ? 230 : static_cast<uint8_t>(40 + (cy * 29) % 120);
+			px[2] = even ? 230 : 60;
+			px[3] = 255;
+		}
+	}
+	auto f = filemanager::open_system_file(fileName, filemanager::FileMode::Write | filemanager::FileMode::Binary);
+	if(!f)
+		return false;
+	fsys::File fp {f};
+	return uimg::save_image(fp, *imgBuf, uimg::ImageFormat::PNG);
+}
+
+std::shared_ptr<unirender::Scene> create_bench_scene(unirender::NodeManager &nodeManager, const BenchSceneParams &params, const std::string &scratchPath, std::string &outErr)
+{
+	unirender::Scene::CreateInfo createInfo {};
+	createInfo.renderer = params.renderer;
+	createInfo.deviceType = unirender::Scene::DeviceType::CPU;
+	createInfo.samples = params.samples;
+	createInfo.denoiseMode = unirender::Scene::DenoiseMode::None;
+	createInfo.hdrOutput = true;
+	createInfo.progressive = false;
+	createInfo.progressiveRefine = false;
+	auto rtScene = unirender::Scene::Create(nodeManager, unirender::Scene::RenderMode::RenderImage, createInfo);
+	if(rtScene == nullptr) {
+		outErr = "Unable to create scene!";
+		return nullptr;
+	}
+
+	std::shared_ptr<unirender::Shader> shader = nullptr;
+	if(params.textureSize > 0) {
+		auto texPath = scratchPath + "bench_albedo_" + std::to_string(params.textureSize) + ".png";
+		if(write_checker_texture(texPath, params.textureSize) == false) {
+			outErr = "Unable to write texture '" + texPath + "'!";
+			return nullptr;
+		}
+		auto albedoShader = unirender::Shader::Create<unirender::ShaderAlbedo>(*rtScene, "benchAlbedo");
+		albedoShader->SetAlbedoMap(texPath);
+		shader = albedoShader;
+	}
+	else
+		shader = unirender::Shader::Create<unirender::ShaderColorTest>(*rtScene, "benchColor");
+
+	// Objects are laid out on a square grid around the origin
+	auto numColumns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(std::max(params.numObjects, 1u)))));
+	auto gridOffset = (numColumns - 1) * PATCH_SPACING * 0.5f;
+	for(uint32_t i = 0; i < params.numObjects; ++i) {
+		auto mesh = create_wave_patch("benchPatch" + std::to_string(i), params.numTriangles, i * 0.7f);
+		mesh->AddSubMeshShader(*shader);
+		auto o = unirender::Object::Create(*rtScene, *mesh);
+		o->SetPos(Vector3 {(i % numColumns) * PATCH_SPACING - gridOffset, 0.f, (i / numColumns) * PATCH_SPACING - gridOffset});
+	}
+
+	auto extent = numColumns * PATCH_SPACING;
+	for(uint32_t i = 0; i < params.numLights; ++i) {
+		auto angle = 2.f * std::numbers::pi_v<float> * i / static_cast<float>(params.numLights);
+		auto light = unirender::Light::Create(*rtScene);
+		light->SetType(unirender::Light::Type::Point);
+		light->SetPos(Vector3 {std::cos(angle) * extent * 0.4f, extent * 0.3f, std::sin(angle) * extent * 0.4f});
+		light->SetColor(Vector3 {1.f, 0.95f, 0.9f});
+		light->SetIntensity(8'000.f / std::max(params.numLights, 1u));
+	}
+
+	auto &cam = rtScene->GetCamera();
+	cam.SetResolution(params.width, params.height);
+	Vector3 camPos {0.f, extent * 0.6f, -extent * 0.9f};
+	cam.SetPos(camPos);
+	cam.SetRotation(uquat::create_look_rotation(uvec::get_normal(-camPos), uvec::UP));
+	return rtScene;
+}
@@ -0,0 +1,29 @@
+#ifndef __RT_BENCH_SCENE_HPP__
+#define __RT_BENCH_SCENE_HPP__
+
+#include <string>
+#include <memory>
+#include <cinttypes>
+
+namespace unirender {
+	class Scene;
+	class NodeManager;
+};
+
+// Parameters of a synthetic benchmark scene. The scene consists of a grid of wave-shaped patches (one mesh per object, so the
+// geometry cost scales with the object count), a shared checker texture and a ring of point lights above the patches.
+struct BenchSceneParams {
+	uint32_t numObjects = 16;
+	uint32_t numTriangles = 20'000; // Per object
+	uint32_t textureSize = 1'024;   // 0 = untextured
+	uint32_t numLights = 4;
+	uint32_t width = 1'280;
+	uint32_t height = 720;
+	uint32_t samples = 32;
+	std::string renderer = "cycles";
+};
+
+// Creates the scene for the CPU device. The texture is written to the scratch directory, since the renderer loads textures from disk.
+std::shared_ptr<unirender::Scene> create_bench_scene(unirender::NodeManager &nodeManager, const BenchSceneParams &params, const std::string &scratchPath, std::string &outErr);
+
+#endif
@@ -0,0 +1,331 @@
+#include "bench_scene.hpp"
+#include "metrics.hpp"
+#include "memory_stats.hpp"
+#include "image_layers.hpp"
+#include <util_raytracing/scene.hpp>
+#include <util_raytracing/renderer.hpp>
+#include <util_raytracing/camera.hpp>
+#include <util_raytracing.hpp>
+#include <util_image.hpp>
+#include <util_image_buffer.hpp>
+#include <sharedutils/util.h>
+#include <sharedutils/util_path.hpp>
+#include <sharedutils/util_file.h>
+#undef __UTIL_STRING_H__
+#include <sharedutils/util_string.h>
+#include <mathutil/uquat.h>
+#include <fsys/filesystem.h>
+#include <fsys/ifile.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <filesystem>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#ifdef __linux__
+#include <sched.h>
+#elif _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+// Measures scene build, finalize, render and output times of synthetic scenes on the CPU device for a range of core counts.
+// Every core count is measured in a separate process, since the renderer sizes its thread pool once per process.
+// Results are appended as JSON lines to the output file, so they can be compared between releases.
+
+static std::shared_ptr<spdlog::logger> g_logger = nullptr;
+
+using Milliseconds = std::chrono::duration<double, std::milli>;
+
+// Renderer creation, render and output times are the totals of all views
+struct BenchTimes {
+	Milliseconds build {};
+	Milliseconds finalize {};
+	Milliseconds rendererCreate {};
+	Milliseconds render {};
+	Milliseconds output {};
+};
+
+static void print_help()
+{
+	std::stringstream ss;
+	ss << "Usage: render_raytracing_bench [-option0 -option1=value ...]\n";
+	ss << "Available options:\n";
+	ss << "-objects=<count>: Number of objects in the scene (Default: 16)\n";
+	ss << "-triangles=<count>: Number of triangles per object (Default: 20000)\n";
+	ss << "-texture_size=<size>: Size of the albedo texture, or 0 for an untextured scene (Default: 1024)\n";
+	ss << "-lights=<count>: Number of point lights (Default: 4)\n";
+	ss << "-width=<width>, -height=<height>: Output resolution (Default: 1280x720)\n";
+	ss << "-samples=<count>: Samples per pixel (Default: 32)\n";
+	ss << "-views=<count>: Number of views that are rendered from the same finalized scene per run, rotating around the scene (Default: 1). The renderer is created for every view, like with -views of render_raytracing, \"renderer_create_ms\" shows how much of the scene preparation is still paid per view\n";
+	ss << "-renderer=<renderer>: Renderer to use (Default: cycles)\n";
+	ss << "-threads=<n0,n1,...>|auto: Core counts to measure. \"auto\" measures powers of two up to the number of hardware threads (Default: auto)\n";
+	ss << "-repeat=<count>: Number of measured runs per core count (Default: 3)\n";
+	ss << "-label=<label>: Label that is written to every result, e.g. the release version\n";
+	ss << "-output=<fileName>: JSON lines file the results are written to (Default: bench_results.json)\n";
+	ss << "-scratch=<path>: Directory for the texture and the rendered images (Default: bench/)\n";
+	std::cout << ss.str() << std::endl;
+}
+
+static std::vector<uint32_t> parse_thread_counts(const std::string &str)
+{
+	auto numHwThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> counts;
+	if(ustring::compare<std::string>(str, "auto", false)) {
+		for(uint32_t n = 1; n < numHwThreads; n *= 2)
+			counts.push_back(n);
+		counts.push_back(numHwThreads);
+		return counts;
+	}
+	std::vector<std::string> values;
+	ustring::explode(str, ",", values);
+	for(auto &val : values) {
+		auto n = util::to_uint(val);
+		if(n > 0)
+			counts.push_back(std::min(n, numHwThreads));
+	}
+	return counts;
+}
+
+// Restricts the process to the first n cores it's allowed to run on. Threads that are created afterwards inherit the restriction.
+static bool set_core_count(uint32_t n)
+{
+#ifdef __linux__
+	cpu_set_t available;
+	if(sched_getaffinity(0, sizeof(available), &available) != 0)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for(uint32_t i = 0; i < CPU_SETSIZE && n > 0; ++i) {
+		if(CPU_ISSET(i, &available) == 0)
+			continue;
+		CPU_SET(i, &set);
+		--n;
+	}
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif _WIN32
+	DWORD_PTR processMask, systemMask;
+	if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) == FALSE)
+		return false;
+	DWORD_PTR mask = 0;
+	for(uint32_t i = 0; i < sizeof(DWORD_PTR) * 8 && n > 0; ++i) {
+		auto bit = static_cast<DWORD_PTR>(1) << i;
+		if((processMask & bit) == 0)
+			continue;
+		mask |= bit;
+		--n;
+	}
+	return SetProcessAffinityMask(GetCurrentProcess(), mask) != FALSE;
+#else
+	return false;
+#endif
+}
+
+static bool run_benchmark(const BenchSceneParams &params, const std::string &scratchPath, uint32_t numThreads, uint32_t numViews, BenchTimes &outTimes, std::string &outErr)
+{
+	auto t = std::chrono::steady_clock::now();
+	auto lap = [&t]() {
+		auto tNow = std::chrono::steady_clock::now();
+		auto delta = std::chrono::duration_cast<Milliseconds>(tNow - t);
+		t = tNow;
+		return delta;
+	};
+
+	auto nodeManager = unirender::NodeManager::Create();
+	auto rtScene = create_bench_scene(*nodeManager, params, scratchPath, outErr);
+	if(rtScene == nullptr)
+		return false;
+	outTimes.build = lap();
+
+	rtScene->Finalize();
+	outTimes.finalize = lap();
+
+	auto &cam = rtScene->GetCamera();
+	auto basePos = cam.GetPos();
+	auto baseRot = cam.GetRotation();
+	for(uint32_t i = 0; i < numViews; ++i) {
+		// Only the camera changes between views, the renderer takes a copy of the scene when it's created
+		auto orbitRot = uquat::create(EulerAngles {0.f, (360.f / static_cast<float>(numViews)) * static_cast<float>(i), 0.f});
+		cam.SetPos(orbitRot * basePos);
+		cam.SetRotation(orbitRot * baseRot);
+		lap();
+
+		auto renderer = unirender::Renderer::Create(*rtScene, params.renderer, outErr, unirender::Renderer::Flags::DisableDisplayDriver);
+		if(renderer == nullptr)
+			return false;
+		outTimes.rendererCreate += lap();
+
+		auto job = renderer->StartRender();
+		job->Start();
+		while(job->IsComplete() == false)
+			std::this_thread::sleep_for(std::chrono::milliseconds {5});
+		if(job->IsCancelled() || job->IsSuccessful() == false) {
+			outErr = "Rendering has failed!";
+			return false;
+		}
+		outTimes.render += lap();
+
+		auto layers = job->GetResult();
+		auto beautyName = find_beauty_layer(layers);
+		if(beautyName.has_value() == false) {
+			outErr = "Render result has no image!";
+			return false;
+		}
+		auto outputPath = scratchPath + "bench_" + std::to_string(numThreads);
+		if(numViews > 1)
+			outputPath += "_view" + std::to_string(i);
+		outputPath += ".hdr";
+		auto f = filemanager::open_system_file(outputPath, filemanager::FileMode::Write | filemanager::FileMode::Binary);
+		if(!f) {
+			outErr = "Failed to open output file '" + outputPath + "'!";
+			return false;
+		}
+		fsys::File fp {f};
+		if(uimg::save_image(fp, *layers.images[*beautyName], uimg::ImageFormat::HDR) == false) {
+			outErr = "Unable to save image as '" + outputPath + "'!";
+			return false;
+		}
+		outTimes.output += lap();
+	}
+	return true;
+}
+
+static void add_params(RTMetrics::Record &record, const BenchSceneParams &params, const std::string &label)
+{
+	record.Add("label", label).Add("renderer", params.renderer);
+	record.Add("objects", params.numObjects).Add("triangles_per_object", params.numTriangles).Add("texture_size", params.textureSize).Add("lights", params.numLights);
+	record.Add("width", params.width).Add("height", params.height).Add("samples", params.samples);
+}
+
+// Runs all measurements for a single core count, in this process
+static int run_thread_count(const BenchSceneParams &params, const std::string &scratchPath, const std::string &label, uint32_t numThreads, uint32_t numViews, uint32_t numRepeats, RTMetrics &metrics)
+{
+	if(set_core_count(numThreads) == false)
+		g_logger->warn("Unable to restrict process to {} cores, all cores will be used!", numThreads);
+	auto result = EXIT_SUCCESS;
+	for(uint32_t i = 0; i < numRepeats; ++i) {
+		BenchTimes times {};
+		std::string err;
+		auto success = run_benchmark(params, scratchPath, numThreads, numViews, times, err);
+		auto memStats = get_memory_stats();
+
+		RTMetrics::Record record {"bench_run"};
+		add_params(record, params, label);
+		record.Add("threads", numThreads).Add("views", numViews).Add("iteration", i).Add("success", success);
+		if(success) {
+			auto total = times.build + times.finalize + times.rendererCreate + times.render + times.output;
+			auto pixelSamples = static_cast<double>(params.width) * params.height * params.samples * numViews;
+			record.Add("build_ms", times.build.count()).Add("finalize_ms", times.finalize.count()).Add("renderer_create_ms", times.rendererCreate.count()).Add("render_ms", times.render.count()).Add("output_ms", times.output.count()).Add("total_ms", total.count());
+			record.Add("renderer_create_ms_per_view", times.rendererCreate.count() / numViews);
+			record.Add("pixel_samples_per_second", (times.render.count() > 0.0) ? (pixelSamples / (times.render.count() / 1'000.0)) : 0.0);
+			g_logger->info("[{} threads, run {}/{}] Build: {:.1f} ms, finalize: {:.1f} ms, renderer creation: {:.1f} ms ({:.1f} ms per view), render: {:.1f} ms, output: {:.1f} ms", numThreads, i + 1, numRepeats, times.build.count(), times.finalize.count(), times.rendererCreate.count(),
+			  times.rendererCreate.count() / numViews, times.render.count(), times.output.count());
+		}
+		else {
+			record.Add("error", err);
+			g_logger->error("[{} threads, run {}/{}] Benchmark has failed: {}", numThreads, i + 1, numRepeats, err);
+			result = EXIT_FAILURE;
+		}
+		record.Add("peak_rss", memStats.peakResidentSize);
+		metrics.Write(record);
+		release_free_memory();
+	}
+	return result;
+}
+
+static std::string quote_arg(const std::string &arg) { return '\"' + arg + '\"'; }
+
+int main(int argc, char *argv[])
+{
+	auto exePath = std::filesystem::absolute(argv[0]).string();
+	auto launchParams = util::get_launch_parameters(argc - 1, argv + 1);
+	if(launchParams.find("-help") != launchParams.end()) {
+		print_help();
+		return EXIT_SUCCESS;
+	}
+
+	// Same layout as render_raytracing, so the renderer modules can be found
+	auto programPath = util::Path::CreatePath(util::get_program_path());
+	programPath.PopBack(); // Go up from "bin" directory
+	auto strPath = programPath.GetString();
+	strPath.pop_back();
+	util::set_program_path(strPath);
+	util::set_current_working_directory(strPath);
+	FileManager::SetAbsoluteRootPath(util::Path::CreatePath(FileManager::GetRootPath()).GetString());
+
+	auto logger = std::make_shared<spdlog::logger>("bench", std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+	logger->set_level(spdlog::level::info);
+	spdlog::register_logger(logger);
+	unirender::set_logger(logger);
+	g_logger = logger;
+
+	auto getParam = [&launchParams](const std::string &name, const std::string &def) {
+		auto it = launchParams.find(name);
+		return (it != launchParams.end()) ? it->second : def;
+	};
+	auto getUint = [&getParam](const std::string &name, uint32_t def) { return util::to_uint(getParam(name, std::to_string(def))); };
+
+	BenchSceneParams params {};
+	params.numObjects = getUint("-objects", params.numObjects);
+	params.numTriangles = getUint("-triangles", params.numTriangles);
+	params.textureSize = getUint("-texture_size", params.textureSize);
+	params.numLights = getUint("-lights", params.numLights);
+	params.width = std::max(getUint("-width", params.width), 1u);
+	params.height = std::max(getUint("-height", params.height), 1u);
+	params.samples = std::max(getUint("-samples", params.samples), 1u);
+	params.renderer = getParam("-renderer", params.renderer);
+	auto numRepeats = std::max(getUint("-repeat", 3), 1u);
+	auto numViews = std::max(getUint("-views", 1), 1u);
+	auto label = getParam("-label", "");
+	auto outputFileName = getParam("-output", "bench_results.json");
+	auto scratchPath = util::Path::CreatePath(getParam("-scratch", "bench/")).GetString();
+	std::error_code ec;
+	std::filesystem::create_directories(scratchPath, ec);
+
+	// Child process for a single core count
+	auto itRunThreads = launchParams.find("-run_threads");
+	if(itRunThreads != launchParams.end()) {
+		auto metrics = RTMetrics::Open(outputFileName);
+		if(metrics == nullptr) {
+			g_logger->error("Unable to open output file '{}'!", outputFileName);
+			return EXIT_FAILURE;
+		}
+		return run_thread_count(params, scratchPath, label, std::max(util::to_uint(itRunThreads->second), 1u), numViews, numRepeats, *metrics);
+	}
+
+	auto threadCounts = parse_thread_counts(getParam("-threads", "auto"));
+	if(threadCounts.empty()) {
+		g_logger->error("No valid core counts specified!");
+		return EXIT_FAILURE;
+	}
+	auto metrics = RTMetrics::Open(outputFileName, false);
+	if(metrics == nullptr) {
+		g_logger->error("Unable to open output file '{}'!", outputFileName);
+		return EXIT_FAILURE;
+	}
+	RTMetrics::Record config {"bench_config"};
+	add_params(config, params, label);
+	config.Add("hardware_threads", std::max(std::thread::hardware_concurrency(), 1u)).Add("views", numViews).Add("repeat", numRepeats);
+	metrics->Write(config);
+
+	std::string args;
+	for(auto i = 1; i < argc; ++i)
+		args += ' ' + quote_arg(argv[i]);
+	auto result = EXIT_SUCCESS;
+	for(auto numThreads : threadCounts) {
+		g_logger->info("Running benchmark with {} cores ({} objects, {} triangles per object, texture size {}, {} lights, {}x{}, {} samples)...", numThreads, params.numObjects, params.numTriangles, params.textureSize, params.numLights, params.width, params.height, params.samples);
+		auto cmd = quote_arg(exePath) + args + " -run_threads=" + std::to_string(numThreads);
+#ifdef _WIN32
+		cmd = quote_arg(cmd); // cmd.exe strips the outer quotes
+#endif
+		if(std::system(cmd.c_str()) != 0) {
+			g_logger->error("Benchmark with {} cores has failed!", numThreads);
+			result = EXIT_FAILURE;
+		}
+	}
+	g_logger->info("Results have been written to '{}'.", outputFileName);
+	return result;
+}
@@ -0,0 +1,30 @@
+#include "image_layers.hpp"
+#undef __UTIL_STRING_H__
+#include <sharedutils/util_string.h>
+#include <array>
+
+bool is_auxiliary_layer(const std::string &name)
+{
+	constexpr std::array<const char *, 4> auxLayers {"albedo", "normal", "normals", "depth"};
+	for(auto *auxName : auxLayers) {
+		if(ustring::compare<std::string>(name, auxName, false))
+			return true;
+	}
+	return false;
+}
+
+std::optional<std::string> find_beauty_layer(const uimg::ImageLayerSet &layers)
+{
+	constexpr std::array<const char *, 4> beautyLayers {"combined", "color", "image", "beauty"};
+	for(auto *beautyName : beautyLayers) {
+		for(auto &[name, imgBuf] : layers.images) {
+			if(ustring::compare<std::string>(name, beautyName, false))
+				return name;
+		}
+	}
+	for(auto &[name, imgBuf] : layers.images) {
+		if(is_auxiliary_layer(name) == false)
+			return name;
+	}
+	return {};
+}
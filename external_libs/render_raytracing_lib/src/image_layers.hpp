@@ -0,0 +1,14 @@
+#ifndef __RT_IMAGE_LAYERS_HPP__
+#define __RT_IMAGE_LAYERS_HPP__
+
+#include <util_image_buffer.hpp>
+#include <string>
+#include <optional>
+
+// Returns true for auxiliary layers like albedo, normals or depth, which aren't part of the final image
+bool is_auxiliary_layer(const std::string &name);
+
+// Returns the name of the layer that contains the final image ("Combined", "Color", etc.), or the first non-auxiliary layer
+std::optional<std::string> find_beauty_layer(const uimg::ImageLayerSet &layers);
+
+#endif
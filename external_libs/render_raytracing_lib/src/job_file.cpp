@@ -0,0 +1,400 @@
+#include "job_file.hpp"
+#include <sharedutils/util_file.h>
+#include <fsys/filesystem.h>
+#include <lz4frame.h>
+#ifdef RT_ENABLE_ZSTD
+#include <zstd.h>
+#endif
+#include <filesystem>
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+static constexpr std::array<uint8_t, 4> LZ4_FRAME_MAGIC = {0x04, 0x22, 0x4D, 0x18};
+static constexpr std::array<uint8_t, 4> ZSTD_FRAME_MAGIC = {0x28, 0xB5, 0x2F, 0xFD};
+
+bool is_job_file_compression_supported(JobFileCompression compression)
+{
+#ifndef RT_ENABLE_ZSTD
+	if(compression == JobFileCompression::Zstd)
+		return false;
+#endif
+	return true;
+}
+
+std::string get_job_file_compression_extension(JobFileCompression compression)
+{
+	switch(compression) {
+	case JobFileCompression::LZ4:
+		return "lz4";
+	case JobFileCompression::Zstd:
+		return "zst";
+	default:
+		break;
+	}
+	return "";
+}
+
+std::optional<JobFileCompression> parse_job_file_compression(const std::string &compression)
+{
+	if(compression == "lz4")
+		return JobFileCompression::LZ4;
+	if(compression == "zstd" || compression == "zst")
+		return JobFileCompression::Zstd;
+	if(compression == "none")
+		return JobFileCompression::None;
+	return {};
+}
+
+std::optional<std::string> find_job_file(const std::string &jobFileName)
+{
+	if(FileManager::ExistsSystem(jobFileName))
+		return jobFileName;
+	for(auto compression : {JobFileCompression::LZ4, JobFileCompression::Zstd}) {
+		auto fileName = jobFileName + "." + get_job_file_compression_extension(compression);
+		if(FileManager::ExistsSystem(fileName))
+			return fileName;
+	}
+	return {};
+}
+
+// If the frame header contains the uncompressed size, the data is decompressed straight into the data stream.
+// Otherwise it's decompressed into a buffer that grows as needed and is copied into the stream at the end.
+struct DecompressionTarget {
+	std::optional<DataStream> stream {};
+	std::vector<uint8_t> buffer {};
+	uint8_t *data = nullptr;
+	size_t capacity = 0;
+	size_t size = 0;
+};
+
+static bool init_target(DecompressionTarget &target, uint64_t contentSize, std::string &outErr)
+{
+	if(contentSize > std::numeric_limits<uint32_t>::max()) {
+		outErr = "Job file exceeds maximum supported size!";
+		return false;
+	}
+	if(contentSize == 0)
+		return true;
+	target.stream = DataStream {static_cast<uint32_t>(contentSize)};
+	(*target.stream)->SetOffset(0);
+	target.data = static_cast<uint8_t *>((*target.stream)->GetData());
+	target.capacity = contentSize;
+	return true;
+}
+
+// Returns the remaining space for decompressed data. The growing buffer is enlarged if it's full, the size of the data
+// stream is fixed. If a frame contains more data than its header specified, the decompressor stops making progress once
+// the stream is full, which has to be treated as an error by the caller.
+static size_t reserve_output(DecompressionTarget &target)
+{
+	if(target.stream.has_value() == false && target.size == target.capacity) {
+		target.buffer.resize(std::max(target.buffer.size() * 2, target.size + CHUNK_SIZE));
+		target.data = target.buffer.data();
+		target.capacity = target.buffer.size();
+	}
+	return target.capacity - target.size;
+}
+
+static bool decompress_lz4(VFilePtrReal &f, std::vector<uint8_t> &inBuf, size_t inSize, DecompressionTarget &out, JobFileLoadInfo &loadInfo, std::string &outErr)
+{
+	LZ4F_dctx *dctx = nullptr;
+	auto r = LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+	if(LZ4F_isError(r)) {
+		outErr = std::string {"Unable to create LZ4 decompression context: "} + LZ4F_getErrorName(r);
+		return false;
+	}
+	std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)> ptrDctx {dctx, &LZ4F_freeDecompressionContext};
+
+	LZ4F_frameInfo_t frameInfo {};
+	size_t inPos = inSize;
+	r = LZ4F_getFrameInfo(dctx, &frameInfo, inBuf.data(), &inPos);
+	if(LZ4F_isError(r)) {
+		outErr = std::string {"Invalid LZ4 frame header: "} + LZ4F_getErrorName(r);
+		return false;
+	}
+	if(init_target(out, frameInfo.contentSize, outErr) == false)
+		return false;
+
+	while(r != 0) {
+		if(inPos == inSize) {
+			inSize = f->Read(inBuf.data(), inBuf.size());
+			inPos = 0;
+			loadInfo.bytesRead += inSize;
+			if(inSize == 0) {
+				outErr = "Unexpected end of LZ4 compressed job file!";
+				return false;
+			}
+		}
+		auto dstSize = reserve_output(out);
+		auto srcSize = inSize - inPos;
+		r = LZ4F_decompress(dctx, out.data + out.size, &dstSize, inBuf.data() + inPos, &srcSize, nullptr);
+		if(LZ4F_isError(r)) {
+			outErr = std::string {"LZ4 decompression failed: "} + LZ4F_getErrorName(r);
+			return false;
+		}
+		if(srcSize == 0 && dstSize == 0) {
+			outErr = "LZ4 compressed job file contains more data than specified in its header!";
+			return false;
+		}
+		inPos += srcSize;
+		out.size += dstSize;
+	}
+	return true;
+}
+
+#ifdef RT_ENABLE_ZSTD
+static bool decompress_zstd(VFilePtrReal &f, std::vector<uint8_t> &inBuf, size_t inSize, DecompressionTarget &out, JobFileLoadInfo &loadInfo, std::string &outErr)
+{
+	std::unique_ptr<ZSTD_DStream, decltype(&ZSTD_freeDStream)> dstream {ZSTD_createDStream(), &ZSTD_freeDStream};
+	if(dstream == nullptr) {
+		outErr = "Unable to create zstd decompression stream!";
+		return false;
+	}
+	auto contentSize = ZSTD_getFrameContentSize(inBuf.data(), inSize);
+	if(contentSize != ZSTD_CONTENTSIZE_UNKNOWN && contentSize != ZSTD_CONTENTSIZE_ERROR && init_target(out, contentSize, outErr) == false)
+		return false;
+
+	ZSTD_inBuffer input {inBuf.data(), inSize, 0};
+	for(;;) {
+		auto dstSize = reserve_output(out);
+		ZSTD_outBuffer output {out.data + out.size, dstSize, 0};
+		auto inPos = input.pos;
+		auto r = ZSTD_decompressStream(dstream.get(), &output, &input);
+		if(ZSTD_isError(r)) {
+			outErr = std::string {"zstd decompression failed: "} + ZSTD_getErrorName(r);
+			return false;
+		}
+		if(r != 0 && output.pos == 0 && input.pos == inPos && input.pos < input.size) {
+			outErr = "zstd compressed job file contains more data than specified in its header!";
+			return false;
+		}
+		out.size += output.pos;
+		if(r == 0)
+			break; // End of frame
+		// The frame footer may still have to be read once the data stream is full
+		if(input.pos == input.size && (output.pos < output.size || out.stream.has_value())) {
+			input.size = f->Read(inBuf.data(), inBuf.size());
+			input.pos = 0;
+			loadInfo.bytesRead += input.size;
+			if(input.size == 0) {
+				outErr = "Unexpected end of zstd compressed job file!";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+#endif
+
+std::optional<DataStream> load_job_file(const std::string &fileName, JobFileLoadInfo &outLoadInfo, std::string &outErr, std::vector<uint8_t> &readBuffer)
+{
+	outLoadInfo = {};
+	auto f = FileManager::OpenSystemFile(fileName.c_str(), "rb");
+	if(f == nullptr) {
+		outErr = "Unable to open job file '" + fileName + "'!";
+		return {};
+	}
+	auto sz = f->GetSize();
+
+	auto &inBuf = readBuffer;
+	inBuf.resize(CHUNK_SIZE);
+	auto inSize = f->Read(inBuf.data(), std::min<size_t>(inBuf.size(), sz));
+	outLoadInfo.bytesRead = inSize;
+
+	auto hasMagic = [&inBuf, inSize](const std::array<uint8_t, 4> &magic) { return inSize >= magic.size() && memcmp(inBuf.data(), magic.data(), magic.size()) == 0; };
+	if(hasMagic(LZ4_FRAME_MAGIC))
+		outLoadInfo.compression = JobFileCompression::LZ4;
+	else if(hasMagic(ZSTD_FRAME_MAGIC))
+		outLoadInfo.compression = JobFileCompression::Zstd;
+
+	if(outLoadInfo.compression == JobFileCompression::None) {
+		// Uncompressed, read the remainder of the file directly into the stream
+		DataStream ds {static_cast<uint32_t>(sz)};
+		ds->SetOffset(0);
+		auto *data = static_cast<uint8_t *>(ds->GetData());
+		memcpy(data, inBuf.data(), inSize);
+		if(sz > inSize)
+			outLoadInfo.bytesRead += f->Read(data + inSize, sz - inSize);
+		outLoadInfo.uncompressedSize = sz;
+		return ds;
+	}
+
+	DecompressionTarget out {};
+	auto success = false;
+	switch(outLoadInfo.compression) {
+	case JobFileCompression::LZ4:
+		success = decompress_lz4(f, inBuf, inSize, out, outLoadInfo, outErr);
+		break;
+	case JobFileCompression::Zstd:
+#ifdef RT_ENABLE_ZSTD
+		success = decompress_zstd(f, inBuf, inSize, out, outLoadInfo, outErr);
+#else
+		outErr = "Job file '" + fileName + "' is zstd compressed, but zstd support is not enabled!";
+#endif
+		break;
+	default:
+		break;
+	}
+	if(success == false)
+		return {};
+	outLoadInfo.uncompressedSize = out.size;
+	if(out.stream.has_value()) {
+		if(out.size != out.capacity) {
+			outErr = "Job file '" + fileName + "' is smaller than specified in its frame header!";
+			return {};
+		}
+		return std::move(*out.stream);
+	}
+	if(out.size > std::numeric_limits<uint32_t>::max()) {
+		outErr = "Job file '" + fileName + "' exceeds maximum supported size!";
+		return {};
+	}
+	DataStream ds {static_cast<uint32_t>(out.size)};
+	ds->SetOffset(0);
+	if(out.size > 0)
+		memcpy(ds->GetData(), out.data, out.size);
+	return ds;
+}
+
+static bool write_all(VFilePtrReal &f, const void *data, size_t size) { return size == 0 || f->Write(data, size) == size; }
+
+static bool compress_lz4(VFilePtrReal &fIn, VFilePtrReal &fOut, uint64_t srcSize, int32_t level, std::string &outErr)
+{
+	LZ4F_cctx *cctx = nullptr;
+	auto r = LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
+	if(LZ4F_isError(r)) {
+		outErr = std::string {"Unable to create LZ4 compression context: "} + LZ4F_getErrorName(r);
+		return false;
+	}
+	std::unique_ptr<LZ4F_cctx, decltype(&LZ4F_freeCompressionContext)> ptrCctx {cctx, &LZ4F_freeCompressionContext};
+
+	LZ4F_preferences_t prefs {};
+	prefs.compressionLevel = level;
+	prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+	prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+	prefs.frameInfo.contentSize = srcSize;
+
+	std::vector<uint8_t> inBuf;
+	inBuf.resize(CHUNK_SIZE);
+	std::vector<uint8_t> outBuf;
+	outBuf.resize(LZ4F_compressBound(CHUNK_SIZE, &prefs) + LZ4F_HEADER_SIZE_MAX);
+
+	auto n = LZ4F_compressBegin(cctx, outBuf.data(), outBuf.size(), &prefs);
+	if(LZ4F_isError(n) || write_all(fOut, outBuf.data(), n) == false) {
+		outErr = "Unable to write LZ4 frame header!";
+		return false;
+	}
+	for(;;) {
+		auto inSize = fIn->Read(inBuf.data(), inBuf.size());
+		if(inSize == 0)
+			break;
+		n = LZ4F_compressUpdate(cctx, outBuf.data(), outBuf.size(), inBuf.data(), inSize, nullptr);
+		if(LZ4F_isError(n)) {
+			outErr = std::string {"LZ4 compression failed: "} + LZ4F_getErrorName(n);
+			return false;
+		}
+		if(write_all(fOut, outBuf.data(), n) == false) {
+			outErr = "Unable to write compressed data!";
+			return false;
+		}
+	}
+	n = LZ4F_compressEnd(cctx, outBuf.data(), outBuf.size(), nullptr);
+	if(LZ4F_isError(n) || write_all(fOut, outBuf.data(), n) == false) {
+		outErr = "Unable to write LZ4 frame footer!";
+		return false;
+	}
+	return true;
+}
+
+#ifdef RT_ENABLE_ZSTD
+static bool compress_zstd(VFilePtrReal &fIn, VFilePtrReal &fOut, uint64_t srcSize, int32_t level, std::string &outErr)
+{
+	std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx {ZSTD_createCCtx(), &ZSTD_freeCCtx};
+	if(cctx == nullptr) {
+		outErr = "Unable to create zstd compression context!";
+		return false;
+	}
+	ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, level);
+	ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_checksumFlag, 1);
+	ZSTD_CCtx_setPledgedSrcSize(cctx.get(), srcSize);
+
+	std::vector<uint8_t> inBuf;
+	inBuf.resize(CHUNK_SIZE);
+	std::vector<uint8_t> outBuf;
+	outBuf.resize(ZSTD_CStreamOutSize());
+	uint64_t totalRead = 0;
+	for(;;) {
+		auto inSize = fIn->Read(inBuf.data(), inBuf.size());
+		totalRead += inSize;
+		auto lastChunk = (inSize == 0 || totalRead >= srcSize);
+		auto mode = lastChunk ? ZSTD_e_end : ZSTD_e_continue;
+		ZSTD_inBuffer input {inBuf.data(), inSize, 0};
+		size_t remaining = 0;
+		do {
+			ZSTD_outBuffer output {outBuf.data(), outBuf.size(), 0};
+			remaining = ZSTD_compressStream2(cctx.get(), &output, &input, mode);
+			if(ZSTD_isError(remaining)) {
+				outErr = std::string {"zstd compression failed: "} + ZSTD_getErrorName(remaining);
+				return false;
+			}
+			if(write_all(fOut, outBuf.data(), output.pos) == false) {
+				outErr = "Unable to write compressed data!";
+				return false;
+			}
+		} while(lastChunk ? (remaining != 0) : (input.pos != input.size));
+		if(lastChunk)
+			break;
+	}
+	return true;
+}
+#endif
+
+bool compress_job_file(const std::string &srcFileName, const std::string &dstFileName, JobFileCompression compression, int32_t level, std::string &outErr)
+{
+	if(is_job_file_compression_supported(compression) == false || compression == JobFileCompression::None) {
+		outErr = "Unsupported compression type!";
+		return false;
+	}
+	auto fIn = FileManager::OpenSystemFile(srcFileName.c_str(), "rb");
+	if(fIn == nullptr) {
+		outErr = "Unable to open job file '" + srcFileName + "'!";
+		return false;
+	}
+	// Write to a temporary file first, so an interrupted compression never leaves a truncated job file behind
+	auto tmpFileName = dstFileName + ".tmp";
+	auto fOut = FileManager::OpenSystemFile(tmpFileName.c_str(), "wb");
+	if(fOut == nullptr) {
+		outErr = "Unable to open output file '" + tmpFileName + "'!";
+		return false;
+	}
+	auto srcSize = fIn->GetSize();
+	auto success = false;
+	switch(compression) {
+	case JobFileCompression::LZ4:
+		success = compress_lz4(fIn, fOut, srcSize, level, outErr);
+		break;
+#ifdef RT_ENABLE_ZSTD
+	case JobFileCompression::Zstd:
+		success = compress_zstd(fIn, fOut, srcSize, level, outErr);
+		break;
+#endif
+	default:
+		break;
+	}
+	fOut = nullptr;
+	fIn = nullptr;
+	std::error_code ec;
+	if(success) {
+		std::filesystem::rename(tmpFileName, dstFileName, ec);
+		if(!ec)
+			return true;
+		outErr = "Unable to rename '" + tmpFileName + "' to '" + dstFileName + "': " + ec.message();
+	}
+	std::filesystem::remove(tmpFileName, ec);
+	return false;
+}
@@ -0,0 +1,34 @@
+#ifndef __RT_JOB_FILE_HPP__
+#define __RT_JOB_FILE_HPP__
+
+#include <sharedutils/datastream.h>
+#include <string>
+#include <optional>
+#include <vector>
+#include <cinttypes>
+
+// Job files can optionally be compressed with LZ4 (frame format) or zstd. The compression
+// is detected by the magic number at the start of the file, so the file extension doesn't matter.
+enum class JobFileCompression : uint8_t { None = 0u, LZ4, Zstd };
+struct JobFileLoadInfo {
+	JobFileCompression compression = JobFileCompression::None;
+	uint64_t bytesRead = 0;
+	uint64_t uncompressedSize = 0;
+};
+
+bool is_job_file_compression_supported(JobFileCompression compression);
+std::string get_job_file_compression_extension(JobFileCompression compression);
+std::optional<JobFileCompression> parse_job_file_compression(const std::string &compression);
+
+// Returns the file name of the job file, or of its compressed counterpart (with a ".lz4" or ".zst" extension appended)
+// if the uncompressed file doesn't exist.
+std::optional<std::string> find_job_file(const std::string &jobFileName);
+
+// Reads the job file and decompresses it chunk by chunk while it's being read, straight into the returned data stream.
+// The file is read through 'readBuffer', which can be reused for the next job so it's only allocated once.
+std::optional<DataStream> load_job_file(const std::string &fileName, JobFileLoadInfo &outLoadInfo, std::string &outErr, std::vector<uint8_t> &readBuffer);
+
+// The uncompressed size is stored in the frame header, so the job can be decompressed without reallocations
+bool compress_job_file(const std::string &srcFileName, const std::string &dstFileName, JobFileCompression compression, int32_t level, std::string &outErr);
+
+#endif
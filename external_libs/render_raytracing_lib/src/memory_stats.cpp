@@ -0,0 +1,46 @@
+#include "memory_stats.hpp"
+#ifdef __linux__
+#include <fstream>
+#include <string>
+#include <iterator>
+#include <cstdlib>
+#include <malloc.h>
+#endif
+
+#ifdef __linux__
+// Returns the value of a "<key>: <value> kB" line of /proc/self/status in bytes
+static uint64_t read_status_value(const std::string &status, const std::string &key)
+{
+	auto pos = status.find(key + ":");
+	if(pos == std::string::npos)
+		return 0;
+	return std::strtoull(status.c_str() + pos + key.size() + 1, nullptr, 10) * 1024;
+}
+
+MemoryStats get_memory_stats()
+{
+	MemoryStats stats {};
+	std::ifstream f {"/proc/self/status"};
+	if(f) {
+		std::string status {std::istreambuf_iterator<char> {f}, std::istreambuf_iterator<char> {}};
+		stats.residentSize = read_status_value(status, "VmRSS");
+		stats.peakResidentSize = read_status_value(status, "VmHWM");
+	}
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	auto info = mallinfo2();
+	stats.heapInUse = info.uordblks + info.hblkhd;
+	stats.heapFree = info.fordblks;
+#endif
+	return stats;
+}
+
+void release_free_memory()
+{
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif
+}
+#else
+MemoryStats get_memory_stats() { return {}; }
+void release_free_memory() {}
+#endif
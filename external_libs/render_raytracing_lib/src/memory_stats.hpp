@@ -0,0 +1,21 @@
+#ifndef __RT_MEMORY_STATS_HPP__
+#define __RT_MEMORY_STATS_HPP__
+
+#include <optional>
+#include <cinttypes>
+
+// Process memory usage, for verifying that memory usage stays stable over long batches. Heap statistics are only
+// available with glibc, all values are 0 if they can't be determined.
+struct MemoryStats {
+	uint64_t residentSize = 0;
+	uint64_t peakResidentSize = 0;
+	uint64_t heapInUse = 0; // Bytes in allocated heap blocks
+	uint64_t heapFree = 0;	// Bytes in free heap blocks that haven't been returned to the OS (fragmentation)
+};
+MemoryStats get_memory_stats();
+
+// Returns free heap memory to the OS (malloc_trim). Should be called after a large number of allocations have been freed,
+// e.g. after a scene has been destroyed. Only supported with glibc.
+void release_free_memory();
+
+#endif
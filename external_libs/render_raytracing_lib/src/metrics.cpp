@@ -0,0 +1,108 @@
+#include "metrics.hpp"
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+
+RTMetrics::Record::Record(const std::string &event)
+{
+	Add("event", event);
+	auto t = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+	Add("timestamp_ms", static_cast<int64_t>(t.count()));
+}
+RTMetrics::Record &RTMetrics::Record::AddRaw(const std::string &key, const std::string &value)
+{
+	m_values.push_back({key, value});
+	return *this;
+}
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, const std::string &value) { return AddRaw(key, '\"' + EscapeString(value) + '\"'); }
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, const char *value) { return Add(key, std::string {value}); }
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, double value)
+{
+	if(std::isfinite(value) == false)
+		return AddRaw(key, "null"); // JSON has no representation for inf/nan
+	std::stringstream ss;
+	ss << std::setprecision(9) << value;
+	return AddRaw(key, ss.str());
+}
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, int64_t value) { return AddRaw(key, std::to_string(value)); }
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, uint64_t value) { return AddRaw(key, std::to_string(value)); }
+RTMetrics::Record &RTMetrics::Record::Add(const std::string &key, bool value) { return AddRaw(key, value ? "true" : "false"); }
+std::string RTMetrics::Record::ToJson() const
+{
+	std::stringstream ss;
+	ss << '{';
+	auto first = true;
+	for(auto &[key, value] : m_values) {
+		if(!first)
+			ss << ',';
+		first = false;
+		ss << '\"' << EscapeString(key) << "\":" << value;
+	}
+	ss << '}';
+	return ss.str();
+}
+
+std::string RTMetrics::EscapeString(const std::string &str)
+{
+	std::string result;
+	result.reserve(str.length());
+	for(auto c : str) {
+		switch(c) {
+		case '\"':
+			result += "\\\"";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		case '\r':
+			result += "\\r";
+			break;
+		case '\t':
+			result += "\\t";
+			break;
+		default:
+			if(static_cast<unsigned char>(c) < 0x20) {
+				std::stringstream ss;
+				ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+				result += ss.str();
+			}
+			else
+				result += c;
+			break;
+		}
+	}
+	return result;
+}
+
+std::shared_ptr<RTMetrics> RTMetrics::Open(const std::string &fileName, bool append)
+{
+	auto metrics = std::shared_ptr<RTMetrics> {new RTMetrics {}};
+	metrics->m_file.open(fileName, append ? (std::ios::out | std::ios::app) : (std::ios::out | std::ios::trunc));
+	if(metrics->m_file.is_open() == false)
+		return nullptr;
+	return metrics;
+}
+
+std::shared_ptr<RTMetrics> RTMetrics::Forward(const std::function<void(const std::string &)> &writeLine)
+{
+	auto metrics = std::shared_ptr<RTMetrics> {new RTMetrics {}};
+	metrics->m_forward = writeLine;
+	return metrics;
+}
+
+void RTMetrics::Write(const Record &record) { WriteLine(record.ToJson()); }
+
+void RTMetrics::WriteLine(const std::string &json)
+{
+	if(m_forward) {
+		m_forward(json);
+		return;
+	}
+	std::scoped_lock lock {m_mutex};
+	m_file << json << '\n';
+	m_file.flush();
+}
@@ -0,0 +1,47 @@
+#ifndef __RT_METRICS_HPP__
+#define __RT_METRICS_HPP__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <functional>
+#include <cinttypes>
+
+// Writes machine-readable metrics as JSON lines (one object per line),
+// so they can be collected and compared by external tools.
+class RTMetrics {
+  public:
+	class Record {
+	  public:
+		Record(const std::string &event);
+		Record &Add(const std::string &key, const std::string &value);
+		Record &Add(const std::string &key, const char *value);
+		Record &Add(const std::string &key, double value);
+		Record &Add(const std::string &key, int64_t value);
+		Record &Add(const std::string &key, uint64_t value);
+		Record &Add(const std::string &key, uint32_t value) { return Add(key, static_cast<uint64_t>(value)); }
+		Record &Add(const std::string &key, int32_t value) { return Add(key, static_cast<int64_t>(value)); }
+		Record &Add(const std::string &key, bool value);
+		std::string ToJson() const;
+	  private:
+		Record &AddRaw(const std::string &key, const std::string &value);
+		std::vector<std::pair<std::string, std::string>> m_values;
+	};
+	static std::string EscapeString(const std::string &str);
+	static std::shared_ptr<RTMetrics> Open(const std::string &fileName, bool append = true);
+	// Passes every record to 'writeLine' instead of writing it to a file, e.g. to hand it to another process
+	static std::shared_ptr<RTMetrics> Forward(const std::function<void(const std::string &)> &writeLine);
+
+	void Write(const Record &record);
+	// Writes a record that has already been converted to JSON
+	void WriteLine(const std::string &json);
+  private:
+	RTMetrics() = default;
+	std::mutex m_mutex;
+	std::ofstream m_file;
+	std::function<void(const std::string &)> m_forward = nullptr;
+};
+
+#endif
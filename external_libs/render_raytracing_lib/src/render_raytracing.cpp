@@ -25,17 +25,81 @@
 #include <fsys/ifile.hpp>
 #include <util_ocio.hpp>
 #include <sstream>
+#include <fstream>
 #include <queue>
+#include <deque>
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+#include <numbers>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <future>
+#include <filesystem>
+#include <functional>
+#include "metrics.hpp"
+#include "job_file.hpp"
+#include "scene_delta.hpp"
+#include "worker_process.hpp"
+#include "image_layers.hpp"
+#include "memory_stats.hpp"
+#include "replay.hpp"
+#include "run_command.hpp"
 
 #pragma optimize("", off)
 static std::shared_ptr<spdlog::logger> g_logger = nullptr;
+
 class RTJobManager {
   public:
 	enum class ToneMapping : uint8_t {
 		None = 0u, // Image will be saved with original HDR colors
 		FilmicBlender
 	};
+	// Camera settings for one view of a multi-view job. Settings that aren't specified are left unchanged.
+	struct ViewInfo {
+		std::string name;
+		std::optional<Vector3> pos {};
+		std::optional<EulerAngles> ang {};
+		std::optional<float> fov {};
+		std::optional<unirender::Camera::CameraType> cameraType {};
+		std::optional<unirender::Camera::PanoramaType> panoramaType {};
+		std::optional<bool> stereoscopic {};
+
+		// If set, the original camera of the job will be rotated around this point by the given yaw angle (turntable)
+		std::optional<Vector3> orbitCenter {};
+		float orbitYaw = 0.f;
+	};
+	struct JobInfo {
+		std::string fileName;
+		bool draft = false; // Reduced quality preview of the job, see -draft
+	};
+	struct DraftInfo {
+		bool spotCheckOnly = false;
+		float resolutionScale = 0.25f;
+		uint32_t samples = 16;
+		std::string directory = "draft/";
+		std::string validationCommand {};
+	};
+	// Base scene of a delta-encoded job set, which is kept alive between the frames of the same shot
+	struct DeltaBaseScene {
+		std::string fileName {};
+		std::shared_ptr<unirender::Scene> scene = nullptr;
+		std::string rendererName {};
+		unirender::Scene::RenderMode renderMode = unirender::Scene::RenderMode::RenderImage;
+		std::optional<unirender::Scene::ColorTransformInfo> colorTransform {};
+		bool applyColorTransform = false;
+		bool draft = false;
+		// Sample count of the noise target that is baked into the scene, see -noise_target
+		std::optional<uint32_t> samples {};
+		std::optional<uint32_t> maxSamples {};
+		std::vector<std::function<void()>> restoreState {};
+
+		// Views modify the camera directly, so it has to be reset separately
+		Vector3 cameraPos {};
+		Quat cameraRot = uquat::identity();
+	};
 	struct DeviceInfo {
 		DeviceInfo(unirender::Scene::DeviceType deviceType) : deviceType {deviceType} {}
 		unirender::Scene::DeviceType deviceType {};
@@ -43,7 +107,63 @@ class RTJobManager {
 		std::shared_ptr<unirender::Renderer> renderer = nullptr;
 		std::shared_ptr<unirender::Scene> rtScene = nullptr;
 		std::chrono::high_resolution_clock::time_point startTime {};
+		std::chrono::steady_clock::time_point renderStartTime {};
+		util::Path outputPath {};
+		std::string jobName {};
+		bool draft = false;
+
+		// Remaining views of a multi-view job, which will be rendered using the same scene
+		std::queue<ViewInfo> pendingViews {};
+		util::Path baseOutputPath {};
+		std::string rendererName {};
+		Vector3 baseCameraPos {};
+		Quat baseCameraRot = uquat::identity();
+
+		unirender::Scene::RenderMode renderMode = unirender::Scene::RenderMode::RenderImage;
+
+		// Only used if HDR masters are enabled, in which case the color transform is applied by us instead of the renderer
+		std::optional<unirender::Scene::ColorTransformInfo> colorTransform {};
+		bool applyColorTransform = false;
+
+		// Only used if a noise target has been specified
+		std::string shotId {};
+		std::optional<uint32_t> samples {};
+		std::optional<uint32_t> maxSamples {};
+
+		DeltaBaseScene deltaBaseScene {};
+
+		// Only used if jobs are isolated in worker processes
+		std::shared_ptr<WorkerProcess> worker = nullptr;
+		std::optional<std::string> workerJob {};
+		float workerProgress = 0.f;
+		bool workerRendering = false; // The timeout only applies once the scene has been loaded
+		std::chrono::steady_clock::time_point workerProgressTime {};
+		uint32_t workerNumSaved = 0;
+	};
+	// Everything that's required to save the result of a render, independent of the device it was rendered on
+	struct OutputInfo {
 		util::Path outputPath {};
+		std::string jobName {};
+		unirender::Scene::RenderMode renderMode = unirender::Scene::RenderMode::RenderImage;
+		std::optional<unirender::Scene::ColorTransformInfo> colorTransform {};
+		bool applyColorTransform = false;
+		bool draft = false;
+		std::string shotId {};
+		std::optional<uint32_t> samples {};
+		std::optional<uint32_t> maxSamples {};
+	};
+	struct NoiseTargetInfo {
+		float targetNoise = 0.01f;
+		uint32_t minSamples = 1;
+		std::optional<uint32_t> maxSamples {};
+	};
+	// Phase timings of a job of a replay, see -replay
+	struct ReplayFrame {
+		double loadMs = 0.0;
+		double sceneMs = 0.0; // Scene creation and finalization
+		double renderMs = 0.0;
+		double outputMs = 0.0;
+		bool evaluated = false;
 	};
 	static std::shared_ptr<RTJobManager> Launch(int argc, char *argv[]);
 	RTJobManager(const RTJobManager &) = delete;
@@ -64,32 +184,110 @@ class RTJobManager {
 	uint32_t GetNumFailed() const { return m_numFailed; }
 	uint32_t GetNumSkipped() const { return m_numSkipped; }
 	void Update();
+
+	bool IsWorker() const { return m_workerChannel != nullptr; }
+	int RunWorker();
+
+	bool IsReplay() const { return m_replay.has_value(); }
+	// Writes the summary of the replay to the report, returns false if any of the thresholds have been exceeded
+	bool FinishReplay();
   private:
-	RTJobManager(std::unordered_map<std::string, std::string> &&launchParams, const std::string &inputFileName);
+	RTJobManager(std::unordered_map<std::string, std::string> &&launchParams, std::vector<std::string> &&args, const std::string &inputFileName);
 	void UpdateJob(DeviceInfo &devInfo);
+	void LogProgress(const DeviceInfo &devInfo, float progress);
+	void SaveResult(const OutputInfo &output, uimg::ImageLayerSet layers);
+	void SaveAovs(const OutputInfo &output, const uimg::ImageLayerSet &layers, const std::optional<std::string> &beautyLayer);
+	void ValidateDraft(const OutputInfo &output, std::optional<std::string> error);
+	void UpdateDraftValidations();
+	void FinishDraftValidation(const OutputInfo &output, const std::optional<std::string> &error);
+	bool IsDraftPending() const;
+	bool StartWorkerJob(const JobInfo &job, DeviceInfo &devInfo);
+	void UpdateWorker(DeviceInfo &devInfo);
+	void HandleWorkerResult(DeviceInfo &devInfo, const std::vector<std::string> &args);
+	void RetryWorkerJob(DeviceInfo &devInfo, const std::string &reason);
+	void ReleaseJobMemory(const std::string &jobName);
+	void EvaluateReplayFrame(const OutputInfo &output, const uimg::ImageBuffer &imgBuf, double outputMs);
+	void SendWorkerResult(const OutputInfo &output, const uimg::ImageLayerSet &result);
 	void PrintHeader(const unirender::Scene::CreateInfo &createInfo, const unirender::Scene::SceneInfo &sceneInfo);
 	void PrintHelp();
 	void PrintCommandHelp();
-	bool StartJob(const std::string &job, DeviceInfo &devInfo);
+	bool StartJob(const JobInfo &job, DeviceInfo &devInfo);
 	void CollectJobs();
+	enum class LoadResult : uint8_t { Success = 0u, Skipped, Failed, HeaderOnly };
+	LoadResult LoadScene(const std::string &jobFileName, DeviceInfo &devInfo, bool determineOutputPath);
+	bool PrepareOutput(const std::string &jobFileName, const util::Path &outputPath, DeviceInfo &devInfo);
+	bool StartScene(DeviceInfo &devInfo);
+	bool StartDeltaJob(const std::string &jobFileName, DeviceInfo &devInfo);
+	void ApplyNoiseTarget(const std::string &jobFileName, unirender::Scene::CreateInfo &createInfo, DeviceInfo &devInfo);
+	void UpdateNoiseTarget(const OutputInfo &output, const uimg::ImageLayerSet &layers);
+	bool LoadViews(const std::string &fileName);
+	void ApplyView(DeviceInfo &devInfo, const ViewInfo &view);
+	bool StartRender(DeviceInfo &devInfo);
+	bool StartNextView(DeviceInfo &devInfo);
+	uint32_t GetJobFailureCount(const DeviceInfo &devInfo) const;
+	void CompressJobs(const std::string &pattern);
+	void MakeDeltas(const std::string &pattern);
+	void Regrade(const std::string &masterDir);
+	std::optional<unirender::Scene::ColorTransformInfo> GetColorTransformOverride() const;
 
 	std::chrono::high_resolution_clock::time_point m_startTime {};
 	std::unordered_map<std::string, std::string> m_launchParams {};
 	std::vector<DeviceInfo> m_devices {};
-	std::queue<std::string> m_jobQueue {};
+	std::deque<JobInfo> m_jobQueue {};
 	uint32_t m_numJobs = 0;
 
-	unirender::Scene::RenderMode m_renderMode;
 	bool m_shutdownOnCompletion = false;
 	bool m_dontCloseOnCompletion = true;
-	float m_exposure = 0.f;
-	float m_gamma = 2.2f;
+	// Only applied when HDR masters are regraded, and only if they've been specified
+	std::optional<float> m_exposure {};
+	std::optional<float> m_gamma {};
 	bool m_saveAsHdr = false;
 	std::string m_inputFileName;
 	uint32_t m_numSucceeded = 0;
 	uint32_t m_numFailed = 0;
 	uint32_t m_numSkipped = 0;
 	ToneMapping m_toneMapping = ToneMapping::FilmicBlender;
+	std::shared_ptr<RTMetrics> m_metrics = nullptr;
+
+	std::optional<NoiseTargetInfo> m_noiseTarget {};
+	std::unordered_map<std::string, uint32_t> m_shotSampleCounts {};
+	uint64_t m_numSamplesSaved = 0;
+
+	std::vector<ViewInfo> m_views {};
+	bool m_saveHdrMasters = false;
+
+	// Supervisor
+	bool m_isolateJobs = false;
+	std::vector<std::string> m_workerArgs {};
+	std::chrono::seconds m_workerTimeout {1800};
+	uint32_t m_maxWorkerRetries = 2;
+	std::unordered_map<std::string, uint32_t> m_jobRetries {};
+	uint32_t m_numWorkerRestarts = 0;
+	// Worker
+	std::unique_ptr<WorkerChannel> m_workerChannel = nullptr;
+
+	// Lower-case names of the auxiliary layers to write, or empty for all layers
+	std::optional<std::vector<std::string>> m_aovs {};
+	uimg::ImageFormat m_aovFormat = uimg::ImageFormat::HDR;
+
+	std::optional<DraftInfo> m_draft {};
+	bool m_batchAborted = false;
+	// Validation commands run asynchronously, so they don't stall the main loop (and with it the worker watchdog)
+	struct PendingDraftValidation {
+		OutputInfo output {};
+		std::future<int> result {};
+	};
+	std::vector<PendingDraftValidation> m_pendingDraftValidations {};
+
+	// Read buffer for loading job files, which is reused between jobs. This is the only memory that outlives a job; the
+	// scene data is allocated by util_raytracing through the regular heap, which is trimmed after every job instead.
+	std::vector<uint8_t> m_jobReadBuffer {};
+
+	std::optional<ReplayManifest> m_replay {};
+	std::string m_replayError {};
+	std::shared_ptr<RTMetrics> m_replayReport = nullptr;
+	std::unordered_map<std::string, ReplayFrame> m_replayFrames {};
+	uint32_t m_numReplayFailures = 0;
 };
 
 std::shared_ptr<RTJobManager> RTJobManager::Launch(int argc, char *argv[])
@@ -100,15 +298,23 @@ std::shared_ptr<RTJobManager> RTJobManager::Launch(int argc, char *argv[])
 
 	auto launchParams = util::get_launch_parameters(argc, argv);
 	auto itJob = launchParams.find("-job");
-	return std::shared_ptr<RTJobManager> {new RTJobManager {std::move(launchParams), (itJob != launchParams.end()) ? itJob->second : ""}};
+	std::vector<std::string> args {argv, argv + argc};
+	return std::shared_ptr<RTJobManager> {new RTJobManager {std::move(launchParams), std::move(args), (itJob != launchParams.end()) ? itJob->second : ""}};
 }
 
-RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launchParams, const std::string &inputFileName) : m_launchParams {std::move(launchParams)}, m_inputFileName {inputFileName}
+RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launchParams, std::vector<std::string> &&args, const std::string &inputFileName) : m_launchParams {std::move(launchParams)}, m_inputFileName {inputFileName}
 {
 	auto conSink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
 	conSink->set_level(spdlog::level::info);
 
-	auto logFilePath = ufile::get_path_from_filename(inputFileName) + "log.txt";
+	std::string logFileName = "log.txt";
+	if(m_launchParams.find("-worker") != m_launchParams.end()) {
+		// Worker processes mustn't overwrite the log of the supervisor
+		m_workerChannel = std::make_unique<WorkerChannel>();
+		auto itDeviceType = m_launchParams.find("-device_type");
+		logFileName = "log_worker_" + ((itDeviceType != m_launchParams.end()) ? itDeviceType->second : std::string {"gpu"}) + ".txt";
+	}
+	auto logFilePath = ufile::get_path_from_filename(inputFileName) + logFileName;
 	auto fileSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(logFilePath, true);
 	fileSink->set_level(spdlog::level::trace);
 
@@ -132,6 +338,30 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 	auto itVerbose = m_launchParams.find("-verbose");
 	unirender::Scene::SetVerbose(itVerbose != m_launchParams.end());
 
+	auto itReplay = m_launchParams.find("-replay");
+	if(itReplay != m_launchParams.end()) {
+		ReplayManifest manifest {};
+		if(load_replay_manifest(itReplay->second, manifest, m_replayError) == false) {
+			g_logger->error("Unable to load replay manifest '{}': {}", itReplay->second, m_replayError);
+			manifest.jobs.clear();
+		}
+		// Every option that affects the rendered image or the timings is pinned, so the results of different runs are comparable
+		for(auto *param : {"-noise_target", "-draft", "-views", "-isolate_jobs", "-hdr_master", "-aovs", "-adaptiveSampling", "-render_mode", "-denoise", "-tonemapped", "-exposure", "-gamma",
+		       "-color_transform", "-color_transform_look", "-sky", "-sky_strength", "-sky_angle", "-camera_type", "-panorama_type", "-stereoscopic", "-horizontal_camera_range", "-vertical_camera_range"})
+			m_launchParams.erase(param);
+		m_launchParams["-samples"] = std::to_string(manifest.samples);
+		m_launchParams["-width"] = std::to_string(manifest.width);
+		m_launchParams["-height"] = std::to_string(manifest.height);
+		m_launchParams["-device_type"] = "cpu";
+		std::error_code ec;
+		std::filesystem::create_directories(manifest.outputDir, ec);
+		m_replayReport = RTMetrics::Open(manifest.reportFileName, false);
+		if(m_replayReport == nullptr)
+			g_logger->error("Unable to open replay report '{}'!", manifest.reportFileName);
+		m_dontCloseOnCompletion = false;
+		m_replay = std::move(manifest);
+	}
+
 	auto itExposure = m_launchParams.find("-exposure");
 	if(itExposure != m_launchParams.end())
 		SetExposure(util::to_float(itExposure->second));
@@ -149,6 +379,78 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 		unirender::set_log_handler([](std::string msg) { g_logger->info(msg); });
 	}
 
+	// Workers don't write to the metrics file themselves, so the records of all processes end up in the file one at a time
+	if(IsWorker() && m_launchParams.find("-forward_metrics") != m_launchParams.end())
+		m_metrics = RTMetrics::Forward([this](const std::string &json) { m_workerChannel->SendLine("metrics\t" + json); });
+	auto itMetrics = m_launchParams.find("-metrics");
+	if(itMetrics != m_launchParams.end() && IsWorker() == false) {
+		m_metrics = RTMetrics::Open(itMetrics->second);
+		if(m_metrics == nullptr)
+			g_logger->error("Unable to open metrics file '{}'!", itMetrics->second);
+	}
+
+	auto itNoiseTarget = m_launchParams.find("-noise_target");
+	if(itNoiseTarget != m_launchParams.end()) {
+		NoiseTargetInfo noiseTarget {};
+		std::vector<std::string> args;
+		ustring::explode_whitespace(itNoiseTarget->second, args);
+		if(args.size() > 0) {
+			noiseTarget.targetNoise = util::to_float(args[0]);
+			if(args.size() > 1) {
+				noiseTarget.minSamples = util::to_uint(args[1]);
+				if(args.size() > 2)
+					noiseTarget.maxSamples = util::to_uint(args[2]);
+			}
+		}
+		if(noiseTarget.targetNoise > 0.f) {
+			noiseTarget.minSamples = umath::max(noiseTarget.minSamples, 1u);
+			m_noiseTarget = noiseTarget;
+		}
+		else
+			g_logger->error("Invalid noise target '{}'! Noise target has to be larger than 0.", itNoiseTarget->second);
+	}
+
+	auto itHdrMaster = m_launchParams.find("-hdr_master");
+	if(itHdrMaster != m_launchParams.end())
+		m_saveHdrMasters = itHdrMaster->second.empty() || util::to_boolean(itHdrMaster->second);
+
+	auto itAovs = m_launchParams.find("-aovs");
+	if(itAovs != m_launchParams.end() && ustring::compare<std::string>(itAovs->second, "0", false) == false) {
+		std::vector<std::string> aovs;
+		if(itAovs->second.empty() == false && ustring::compare<std::string>(itAovs->second, "all", false) == false) {
+			ustring::explode(itAovs->second, ",", aovs);
+			for(auto &aov : aovs)
+				ustring::to_lower(aov);
+		}
+		m_aovs = std::move(aovs);
+		auto itAovFormat = m_launchParams.find("-aov_format");
+		if(itAovFormat != m_launchParams.end() && ustring::compare<std::string>(itAovFormat->second, "png", false))
+			m_aovFormat = uimg::ImageFormat::PNG;
+	}
+
+	auto itDraft = m_launchParams.find("-draft");
+	if(itDraft != m_launchParams.end() && ustring::compare<std::string>(itDraft->second, "0", false) == false) {
+		DraftInfo draft {};
+		draft.spotCheckOnly = ustring::compare<std::string>(itDraft->second, "spot", false);
+		auto itDraftScale = m_launchParams.find("-draft_scale");
+		if(itDraftScale != m_launchParams.end())
+			draft.resolutionScale = umath::clamp(util::to_float(itDraftScale->second), 0.01f, 1.f);
+		auto itDraftSamples = m_launchParams.find("-draft_samples");
+		if(itDraftSamples != m_launchParams.end())
+			draft.samples = umath::max(util::to_uint(itDraftSamples->second), 1u);
+		auto itDraftDir = m_launchParams.find("-draft_dir");
+		if(itDraftDir != m_launchParams.end())
+			draft.directory = util::Path::CreatePath(itDraftDir->second).GetString();
+		auto itDraftValidate = m_launchParams.find("-draft_validate");
+		if(itDraftValidate != m_launchParams.end())
+			draft.validationCommand = itDraftValidate->second;
+		m_draft = draft;
+	}
+
+	auto itViews = m_launchParams.find("-views");
+	if(itViews != m_launchParams.end() && LoadViews(itViews->second))
+		g_logger->info("Rendering {} views per job.", m_views.size());
+
 #if 0
 	auto itToneMapping = m_launchParams.find("-tone_mapping");
 	if(itToneMapping != m_launchParams.end())
@@ -174,6 +476,33 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 	if(m_devices.empty())
 		m_devices.push_back(unirender::Scene::DeviceType::GPU);
 
+	// Workers receive their jobs from the supervisor process
+	if(IsWorker())
+		return;
+
+	auto itIsolateJobs = m_launchParams.find("-isolate_jobs");
+	if(itIsolateJobs != m_launchParams.end() && (itIsolateJobs->second.empty() || util::to_boolean(itIsolateJobs->second))) {
+		if(is_worker_process_supported()) {
+			m_isolateJobs = true;
+			for(auto &arg : args) {
+				if(ustring::compare<std::string>(arg.substr(0, 13), "-isolate_jobs", false) || ustring::compare<std::string>(arg.substr(0, 12), "-device_type", false)
+				  || ustring::compare<std::string>(arg.substr(0, 8), "-metrics", false))
+					continue;
+				m_workerArgs.push_back(arg);
+			}
+			if(m_metrics)
+				m_workerArgs.push_back("-forward_metrics");
+		}
+		else
+			g_logger->warn("Worker processes are not supported on this platform! Jobs will be executed in the main process.");
+	}
+	auto itWorkerTimeout = m_launchParams.find("-worker_timeout");
+	if(itWorkerTimeout != m_launchParams.end())
+		m_workerTimeout = std::chrono::seconds {util::to_uint(itWorkerTimeout->second)};
+	auto itWorkerRetries = m_launchParams.find("-worker_retries");
+	if(itWorkerRetries != m_launchParams.end())
+		m_maxWorkerRetries = util::to_uint(itWorkerRetries->second);
+
 	util::minimize_window_to_tray();
 	util::CommandManager::StartAsync();
 
@@ -182,6 +511,24 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 		return;
 	}
 
+	auto itRegrade = m_launchParams.find("-regrade");
+	if(itRegrade != m_launchParams.end()) {
+		Regrade(itRegrade->second);
+		return;
+	}
+
+	auto itCompressJobs = m_launchParams.find("-compress_jobs");
+	if(itCompressJobs != m_launchParams.end()) {
+		CompressJobs(itCompressJobs->second);
+		return;
+	}
+
+	auto itMakeDeltas = m_launchParams.find("-make_deltas");
+	if(itMakeDeltas != m_launchParams.end()) {
+		MakeDeltas(itMakeDeltas->second);
+		return;
+	}
+
 	util::CommandManager::RegisterCommand("pause", [this](std::vector<std::string> args) {
 		uint32_t numPaused = 0;
 		uint32_t numFailed = 0;
@@ -293,6 +640,8 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 
 	for(auto &devInfo : m_devices)
 		g_logger->info("Using device: {}", magic_enum::enum_name(devInfo.deviceType));
+	if(m_isolateJobs)
+		g_logger->info("Jobs will be executed in isolated worker processes (timeout: {} seconds, retries: {}).", m_workerTimeout.count(), m_maxWorkerRetries);
 
 	CollectJobs();
 
@@ -302,7 +651,18 @@ RTJobManager::RTJobManager(std::unordered_map<std::string, std::string> &&launch
 
 RTJobManager::~RTJobManager()
 {
-	util::CommandManager::Join();
+	if(IsWorker() == false)
+		util::CommandManager::Join();
+	// Give idle workers a chance to shut down the renderer cleanly, they're only killed if they don't exit in time
+	auto quitDeadline = std::chrono::steady_clock::now() + std::chrono::seconds {10};
+	for(auto &devInfo : m_devices) {
+		if(devInfo.worker && devInfo.workerJob.has_value() == false)
+			devInfo.worker->RequestQuit();
+	}
+	for(auto &devInfo : m_devices) {
+		if(devInfo.worker)
+			devInfo.worker->WaitForExit(quitDeadline);
+	}
 	m_devices.clear();
 	unirender::Renderer::Close();
 
@@ -310,19 +670,31 @@ RTJobManager::~RTJobManager()
 	spdlog::shutdown();
 }
 
+static bool is_device_busy(const RTJobManager::DeviceInfo &devInfo) { return devInfo.job.has_value() || devInfo.workerJob.has_value(); }
+
 bool RTJobManager::IsComplete() const
 {
-	if(m_jobQueue.empty() == false)
+	if(m_jobQueue.empty() == false || m_pendingDraftValidations.empty() == false)
 		return false;
-	auto itDev = std::find_if(m_devices.begin(), m_devices.end(), [](const DeviceInfo &devInfo) { return devInfo.job.has_value(); });
+	auto itDev = std::find_if(m_devices.begin(), m_devices.end(), [](const DeviceInfo &devInfo) { return is_device_busy(devInfo); });
 	return itDev == m_devices.end();
 }
 
 void RTJobManager::CollectJobs()
 {
+	if(m_replay.has_value()) {
+		// Recorded jobs are rendered in the order of the manifest, without any reordering for spot checks
+		for(auto &job : m_replay->jobs)
+			m_jobQueue.push_back({job.fileName, false});
+		m_numJobs = m_jobQueue.size();
+		g_logger->info("Replaying {} jobs with {} samples at {}x{} on the CPU, results will be written to '{}'.", m_replay->jobs.size(), m_replay->samples, m_replay->width, m_replay->height, m_replay->reportFileName);
+		return;
+	}
+
 	std::vector<std::string> lines {};
 
 	std::vector<std::string> jobs {};
+	std::vector<std::string> spotCheckJobs {};
 	for(auto &param : m_launchParams) {
 		if(param.first.empty() || param.first.front() == '-')
 			continue;
@@ -362,6 +734,7 @@ void RTJobManager::CollectJobs()
 			// and then render the rest of them sequentially.
 			std::vector<std::string> orderedJobs {};
 			orderedJobs.reserve(ljobs.size());
+			size_t numSpotCheckJobs = 0;
 			if(ljobs.size() > 1) {
 				auto start = 0u;
 				auto end = ljobs.size();
@@ -375,6 +748,7 @@ void RTJobManager::CollectJobs()
 						pos += (end - start) / i;
 					}
 				}
+				numSpotCheckJobs = orderedJobs.size();
 			}
 
 			for(auto &ljob : ljobs) {
@@ -388,12 +762,21 @@ void RTJobManager::CollectJobs()
 			auto path = ufile::get_path_from_filename(m_inputFileName);
 			for(auto &job : orderedJobs)
 				jobs.push_back(path + job);
+			for(size_t i = 0; i < numSpotCheckJobs; ++i)
+				spotCheckJobs.push_back(path + orderedJobs[i]);
 		}
 	}
 
+	if(m_draft.has_value()) {
+		// The draft pass is rendered first, the final pass only starts once all drafts have passed validation
+		auto &draftJobs = (m_draft->spotCheckOnly && spotCheckJobs.empty() == false) ? spotCheckJobs : jobs;
+		for(auto &job : draftJobs)
+			m_jobQueue.push_back({job, true});
+		g_logger->info("Rendering {} drafts at {}% resolution with {} samples before the final pass...", draftJobs.size(), util::round_string(m_draft->resolutionScale * 100.f, 0), m_draft->samples);
+	}
 	for(auto &job : jobs)
-		m_jobQueue.push(job);
-	m_numJobs = m_jobQueue.size();
+		m_jobQueue.push_back({job, false});
+	m_numJobs = m_jobQueue.size() * umath::max<size_t>(m_views.size(), 1);
 
 	if(m_jobQueue.empty()) {
 		g_logger->warn("No jobs specified!");
@@ -405,152 +788,568 @@ void RTJobManager::CollectJobs()
 void RTJobManager::Update()
 {
 	util::CommandManager::PollEvents();
-	if(util::CommandManager::ShouldExit()) {
-		while(m_jobQueue.empty() == false)
-			m_jobQueue.pop();
-	}
+	if(util::CommandManager::ShouldExit())
+		m_jobQueue.clear();
 	StartNextJob();
 	auto allBusy = true;
 	for(auto &devInfo : m_devices) {
 		UpdateJob(devInfo);
-		if(devInfo.job.has_value() == false)
+		UpdateWorker(devInfo);
+		if(is_device_busy(devInfo) == false)
 			allBusy = false;
 	}
+	UpdateDraftValidations();
 	if(allBusy)
 		std::this_thread::sleep_for(std::chrono::seconds {5});
 }
 
+static bool is_lightmap_bake(unirender::Scene::RenderMode renderMode) { return renderMode == unirender::Scene::RenderMode::BakeDiffuseLighting || renderMode == unirender::Scene::RenderMode::BakeDiffuseLightingSeparate; }
+
+static util::Path get_hdr_master_path(const util::Path &outputPath)
+{
+	auto path = outputPath;
+	path.RemoveFileExtension(std::vector<std::string> {"png"});
+	path += "_master.hdr";
+	return path;
+}
+
+// The color transform the job was rendered with is stored next to its HDR master, so -regrade can re-apply it
+static std::string get_master_color_transform_path(const std::string &masterPath) { return masterPath.substr(0, masterPath.length() - std::string {".hdr"}.length()) + ".transform"; }
+
+static bool save_master_color_transform(const std::string &masterPath, const std::optional<unirender::Scene::ColorTransformInfo> &colorTransform)
+{
+	auto path = get_master_color_transform_path(masterPath);
+	if(colorTransform.has_value() == false) {
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		return true;
+	}
+	std::ofstream f {path, std::ios::trunc};
+	if(f.is_open() == false)
+		return false;
+	f << "config=" << colorTransform->config << "\n";
+	if(colorTransform->lookName.has_value())
+		f << "look=" << *colorTransform->lookName << "\n";
+	return f.good();
+}
+
+static std::optional<unirender::Scene::ColorTransformInfo> load_master_color_transform(const std::string &masterPath)
+{
+	std::ifstream f {get_master_color_transform_path(masterPath)};
+	if(f.is_open() == false)
+		return {};
+	unirender::Scene::ColorTransformInfo colorTransform {};
+	std::string line;
+	while(std::getline(f, line)) {
+		auto sep = line.find('=');
+		if(sep == std::string::npos)
+			continue;
+		auto key = line.substr(0, sep);
+		if(key == "config")
+			colorTransform.config = line.substr(sep + 1);
+		else if(key == "look")
+			colorTransform.lookName = line.substr(sep + 1);
+	}
+	if(colorTransform.config.empty())
+		return {};
+	return colorTransform;
+}
+
+// Without an exposure or gamma, the processor is created the same way the renderer creates its own
+static std::shared_ptr<util::ocio::ColorProcessor> create_color_processor(const unirender::Scene::ColorTransformInfo &colorTransform, std::optional<float> exposure, std::optional<float> gamma, std::string &outErr)
+{
+	auto configLocation = util::Path::CreatePath(util::get_program_path());
+	configLocation += "modules/open_color_io/configs/";
+
+	util::ocio::ColorProcessor::CreateInfo createInfo {};
+	createInfo.configLocation = configLocation.GetString();
+	createInfo.config = colorTransform.config;
+	createInfo.lookName = colorTransform.lookName;
+	createInfo.bitDepth = util::ocio::ColorProcessor::CreateInfo::BitDepth::Float32;
+	if(exposure.has_value() == false && gamma.has_value() == false)
+		return util::ocio::ColorProcessor::Create(createInfo, outErr);
+	return util::ocio::ColorProcessor::Create(createInfo, outErr, exposure.value_or(0.f), gamma.value_or(2.2f));
+}
+
+// Applies the color processor to the linear HDR image and converts it to LDR. Without a color processor, only the
+// exposure (in stops) and gamma are applied, if they've been specified.
+static bool apply_grade(uimg::ImageBuffer &imgBuf, util::ocio::ColorProcessor *processor, std::optional<float> exposure, std::optional<float> gamma, std::string &outErr)
+{
+	if(processor) {
+		imgBuf.Convert(uimg::Format::RGBA_FLOAT);
+		if(processor->Apply(imgBuf, outErr) == false)
+			return false;
+	}
+	else if(exposure.has_value() || gamma.has_value()) {
+		imgBuf.Convert(uimg::Format::RGBA_FLOAT);
+		auto scale = std::pow(2.f, exposure.value_or(0.f));
+		auto invGamma = (gamma.value_or(1.f) > 0.f) ? (1.f / gamma.value_or(1.f)) : 1.f;
+		auto *data = static_cast<float *>(imgBuf.GetData());
+		auto numPixels = static_cast<size_t>(imgBuf.GetWidth()) * imgBuf.GetHeight();
+		for(size_t i = 0; i < numPixels; ++i) {
+			auto *px = data + i * 4;
+			for(uint8_t c = 0; c < 3; ++c)
+				px[c] = std::pow(std::max(px[c] * scale, 0.f), invGamma);
+		}
+	}
+	imgBuf.Convert(uimg::Format::RGB_LDR);
+	return true;
+}
+
+static bool apply_grade(uimg::ImageBuffer &imgBuf, const std::optional<unirender::Scene::ColorTransformInfo> &colorTransform, std::optional<float> exposure, std::optional<float> gamma, std::string &outErr)
+{
+	std::shared_ptr<util::ocio::ColorProcessor> processor = nullptr;
+	if(colorTransform.has_value()) {
+		processor = create_color_processor(*colorTransform, exposure, gamma, outErr);
+		if(processor == nullptr)
+			return false;
+	}
+	return apply_grade(imgBuf, processor.get(), exposure, gamma, outErr);
+}
+
+// Basic sanity checks for draft images, which would indicate a broken shot
+static std::optional<std::string> check_draft_image(const uimg::ImageBuffer &imgBuf)
+{
+	auto floatBuf = imgBuf.Copy(uimg::Format::RGBA_FLOAT);
+	auto *data = static_cast<const float *>(floatBuf->GetData());
+	auto numPixels = static_cast<size_t>(floatBuf->GetWidth()) * floatBuf->GetHeight();
+	auto isBlack = true;
+	for(size_t i = 0; i < numPixels; ++i) {
+		auto *px = data + i * 4;
+		for(uint8_t c = 0; c < 3; ++c) {
+			if(std::isfinite(px[c]) == false)
+				return "Image contains invalid (NaN or infinite) pixels";
+			if(px[c] > 0.f)
+				isBlack = false;
+		}
+	}
+	if(isBlack)
+		return "Image is completely black";
+	return {};
+}
+
+void RTJobManager::LogProgress(const DeviceInfo &devInfo, float progress)
+{
+	auto tDelta = std::chrono::high_resolution_clock::now() - devInfo.startTime;
+	double tDeltaD = tDelta.count() / static_cast<double>(progress) * static_cast<double>(1.f - progress);
+	auto strTime = util::get_pretty_duration(tDeltaD / 1'000'000.0);
+	std::stringstream ss;
+	ss << "Progress for job '" << ufile::get_file_from_filename(devInfo.outputPath.GetString()) << "': " << util::round_string(progress * 100.f, 2) << " %";
+	if(progress > 0.f)
+		ss << " Time remaining: " << strTime << ".";
+
+	auto numCompleted = m_numSucceeded + m_numFailed + m_numSkipped;
+	auto totalProgress = (numCompleted + progress) / static_cast<float>(m_numJobs);
+	ss << " Total progress: " << util::round_string(totalProgress * 100.f, 2.f) << "%";
+
+	auto tDeltaAll = std::chrono::high_resolution_clock::now() - m_startTime;
+	auto tDeltaMs = std::chrono::duration_cast<std::chrono::milliseconds>(tDeltaAll);
+	auto timePassed = util::get_pretty_duration(tDeltaMs.count());
+	ss << " Total time passed: " << timePassed;
+
+	auto numComplete = m_numSucceeded + progress;
+	auto numLeft = m_numJobs - m_numFailed - m_numSkipped - numComplete;
+	auto tRemainingMs = (tDeltaMs / numComplete) * numLeft;
+	auto timeRemaining = util::get_pretty_duration(tRemainingMs.count());
+	ss << " Total time remaining: " << timeRemaining;
+	g_logger->info(ss.str());
+}
+
+void RTJobManager::SaveResult(const OutputInfo &output, uimg::ImageLayerSet layers)
+{
+	auto tSave = std::chrono::steady_clock::now();
+	auto &images = layers.images;
+	auto beautyLayer = find_beauty_layer(layers);
+	auto imgBuf = beautyLayer.has_value() ? images[*beautyLayer] : images.begin()->second;
+
+	g_logger->info("Saving images...");
+	std::optional<std::string> errMsg {};
+	if(is_lightmap_bake(output.renderMode)) {
+		struct OutputImageInfo {
+			std::string suffix = "";
+			std::shared_ptr<uimg::ImageBuffer> imgBuf;
+		};
+		std::vector<OutputImageInfo> outputImageInfos;
+		if(output.renderMode == unirender::Scene::RenderMode::BakeDiffuseLighting)
+			outputImageInfos.push_back({"", imgBuf});
+		else {
+			outputImageInfos.push_back({"_direct", images["DiffuseDirect"]});
+			outputImageInfos.push_back({"_indirect", images["DiffuseIndirect"]});
+		}
+		for(auto &outputImgInfo : outputImageInfos) {
+			auto path = output.outputPath;
+			path.RemoveFileExtension(std::vector<std::string> {"hdr", "dds"});
+			path += outputImgInfo.suffix;
+
+			if(m_saveAsHdr) {
+				path += ".hdr";
+				auto f = filemanager::open_system_file(path.GetString(), filemanager::FileMode::Write | filemanager::FileMode::Binary);
+				if(!f) {
+					errMsg = "Failed to open output file '" + path.GetString() + "'!";
+					continue;
+				}
+				fsys::File fp {f};
+				if(!uimg::save_image(fp, *outputImgInfo.imgBuf, uimg::ImageFormat::HDR))
+					errMsg = "Unable to save image as '" + output.outputPath.GetString() + "'!";
+				continue;
+			}
+			path += ".dds";
+			uimg::TextureInfo texInfo {};
+			texInfo.containerFormat = uimg::TextureInfo::ContainerFormat::DDS;
+			texInfo.inputFormat = uimg::TextureInfo::InputFormat::R16G16B16A16_Float;
+			texInfo.outputFormat = uimg::TextureInfo::OutputFormat::BC6;
+			texInfo.flags = uimg::TextureInfo::Flags::GenerateMipmaps;
+			uimg::TextureSaveInfo saveInfo {};
+			saveInfo.texInfo = texInfo;
+			if(uimg::save_texture(path.GetString(), *outputImgInfo.imgBuf, saveInfo, nullptr, true) == false)
+				errMsg = "Unable to save image as '" + output.outputPath.GetString() + "'!";
+		}
+	}
+	else {
+		std::optional<std::string> draftError {};
+		auto fImg = FileManager::OpenSystemFile(output.outputPath.GetString().c_str(), "wb");
+		if(fImg) {
+			/*auto ocioConfigLocation = util::Path::CreatePath(util::get_program_path());
+			ocioConfigLocation += "../modules/open_color_io/configs/";
+			ocioConfigLocation.Canonicalize();*/
+			switch(m_toneMapping) {
+			case ToneMapping::FilmicBlender:
+				{
+					//std::string err;
+					//if(util::ocio::apply_color_transform(*imgBuf,util::ocio::Config::FilmicBlender,ocioConfigLocation.GetString(),err,m_exposure,m_gamma) == false)
+					//	errMsg = "Unable to apply OCIO color transform: " +err;
+					//imgBuf->ToLDR();
+					//imgBuf->ClearAlpha(std::numeric_limits<uint8_t>::max());
+					break;
+				}
+			}
+
+			if(errMsg.has_value() == false) {
+				auto result = false;
+				if(output.draft)
+					draftError = check_draft_image(*imgBuf);
+				if(m_saveHdrMasters && output.draft == false) {
+					auto masterPath = get_hdr_master_path(output.outputPath);
+					auto fMaster = filemanager::open_system_file(masterPath.GetString(), filemanager::FileMode::Write | filemanager::FileMode::Binary);
+					if(fMaster) {
+						fsys::File fpMaster {fMaster};
+						if(uimg::save_image(fpMaster, *imgBuf, uimg::ImageFormat::HDR) == false)
+							g_logger->error("Unable to save HDR master '{}'!", masterPath.GetString());
+						else if(save_master_color_transform(masterPath.GetString(), output.colorTransform) == false)
+							g_logger->error("Unable to save color transform of HDR master '{}'!", masterPath.GetString());
+					}
+					else
+						g_logger->error("Failed to open HDR master file '{}'!", masterPath.GetString());
+				}
+				if(output.applyColorTransform) {
+					// The job's own color transform, so the image is the same as if the renderer had applied it
+					std::string err;
+					if(apply_grade(*imgBuf, output.colorTransform, {}, {}, err) == false)
+						errMsg = "Unable to apply color transform: " + err;
+				}
+				imgBuf->Convert(uimg::Format::RGB_LDR);
+
+				//if(imgBuf->IsHDRFormat() || imgBuf->IsFloatFormat())
+				//	result = uimg::save_image(fImg,*imgBuf,uimg::ImageFormat::HDR);
+				//else
+				fsys::File fp {fImg};
+				result = uimg::save_image(fp, *imgBuf, uimg::ImageFormat::PNG);
+				if(result == false)
+					errMsg = "Unable to save image as '" + output.outputPath.GetString() + "'!";
+			}
+		}
+		if(errMsg.has_value()) {
+			g_logger->error(*errMsg);
+			fImg = nullptr;
+			FileManager::RemoveSystemFile(output.outputPath.GetString().c_str());
+			if(output.draft) {
+				// A draft that couldn't be saved can't be validated, which has to be treated like a draft that has failed validation
+				++m_numFailed;
+				FinishDraftValidation(output, errMsg);
+			}
+		}
+		else {
+			++m_numSucceeded;
+			if(output.draft)
+				ValidateDraft(output, draftError);
+			else if(m_aovs.has_value())
+				SaveAovs(output, layers, beautyLayer);
+			if(m_replay.has_value())
+				EvaluateReplayFrame(output, *imgBuf, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tSave).count());
+		}
+	}
+}
+
+void RTJobManager::SaveAovs(const OutputInfo &output, const uimg::ImageLayerSet &layers, const std::optional<std::string> &beautyLayer)
+{
+	for(auto &[name, imgBuf] : layers.images) {
+		if(beautyLayer.has_value() && name == *beautyLayer)
+			continue;
+		auto layerName = name;
+		ustring::to_lower(layerName);
+		if(m_aovs->empty() == false && std::find(m_aovs->begin(), m_aovs->end(), layerName) == m_aovs->end())
+			continue;
+		auto path = output.outputPath;
+		path.RemoveFileExtension(std::vector<std::string> {"png"});
+		path += "_" + layerName + ((m_aovFormat == uimg::ImageFormat::HDR) ? ".hdr" : ".png");
+		auto f = filemanager::open_system_file(path.GetString(), filemanager::FileMode::Write | filemanager::FileMode::Binary);
+		if(!f) {
+			g_logger->error("Failed to open output file '{}' for layer '{}'!", path.GetString(), name);
+			continue;
+		}
+		fsys::File fp {f};
+		auto success = false;
+		if(m_aovFormat == uimg::ImageFormat::HDR)
+			success = uimg::save_image(fp, *imgBuf, uimg::ImageFormat::HDR);
+		else {
+			auto ldrBuf = imgBuf->Copy(uimg::Format::RGB_LDR);
+			success = uimg::save_image(fp, *ldrBuf, uimg::ImageFormat::PNG);
+		}
+		if(success == false)
+			g_logger->error("Unable to save layer '{}' as '{}'!", name, path.GetString());
+	}
+}
+
+void RTJobManager::ValidateDraft(const OutputInfo &output, std::optional<std::string> error)
+{
+	if(error.has_value() || m_draft->validationCommand.empty()) {
+		FinishDraftValidation(output, error);
+		return;
+	}
+	m_pendingDraftValidations.push_back({output, std::async(std::launch::async, [cmd = m_draft->validationCommand, path = output.outputPath.GetString()]() { return run_command(cmd, path); })});
+}
+
+void RTJobManager::UpdateDraftValidations()
+{
+	for(auto it = m_pendingDraftValidations.begin(); it != m_pendingDraftValidations.end();) {
+		if(it->result.wait_for(std::chrono::seconds {0}) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+		auto output = std::move(it->output);
+		auto result = it->result.get();
+		it = m_pendingDraftValidations.erase(it);
+		std::optional<std::string> error {};
+		if(result != 0)
+			error = "Validation command returned " + std::to_string(result);
+		FinishDraftValidation(output, error);
+	}
+}
+
+void RTJobManager::FinishDraftValidation(const OutputInfo &output, const std::optional<std::string> &error)
+{
+	if(m_metrics) {
+		RTMetrics::Record record {"draft_validation"};
+		record.Add("job", output.jobName).Add("output", output.outputPath.GetString()).Add("passed", error.has_value() == false);
+		if(error.has_value())
+			record.Add("reason", *error);
+		m_metrics->Write(record);
+	}
+	if(error.has_value() == false)
+		return;
+	g_logger->error("Draft '{}' has been flagged by validation: {}", output.outputPath.GetString(), *error);
+	if(m_batchAborted)
+		return;
+	m_batchAborted = true;
+	// The remaining jobs are counted as skipped, so the summary still adds up to the total number of jobs
+	auto numViews = static_cast<uint32_t>(umath::max<size_t>(m_views.size(), 1));
+	auto numJobs = m_jobQueue.size();
+	m_jobQueue.clear();
+	m_numSkipped += static_cast<uint32_t>(numJobs) * numViews;
+	g_logger->error("Aborting batch! {} remaining jobs will not be rendered.", numJobs);
+}
+
+bool RTJobManager::IsDraftPending() const
+{
+	if(m_pendingDraftValidations.empty() == false)
+		return true;
+	for(auto &devInfo : m_devices) {
+		if(devInfo.draft && is_device_busy(devInfo))
+			return true;
+	}
+	return false;
+}
+
+static RTJobManager::OutputInfo get_output_info(const RTJobManager::DeviceInfo &devInfo)
+{
+	RTJobManager::OutputInfo output {};
+	output.outputPath = devInfo.outputPath;
+	output.jobName = devInfo.jobName;
+	output.renderMode = devInfo.renderMode;
+	output.colorTransform = devInfo.colorTransform;
+	output.applyColorTransform = devInfo.applyColorTransform;
+	output.draft = devInfo.draft;
+	output.shotId = devInfo.shotId;
+	output.samples = devInfo.samples;
+	output.maxSamples = devInfo.maxSamples;
+	return output;
+}
+
 void RTJobManager::UpdateJob(DeviceInfo &devInfo)
 {
 	if(devInfo.job.has_value() == false)
 		return;
 	auto &job = *devInfo.job;
 	if(job.IsComplete() == false) {
+		auto progress = job.GetProgress();
 		if(util::CommandManager::ShouldExit())
 			job.Cancel();
-		else {
-			auto progress = job.GetProgress();
-			auto tDelta = std::chrono::high_resolution_clock::now() - devInfo.startTime;
-			double tDeltaD = tDelta.count() / static_cast<double>(progress) * static_cast<double>(1.f - progress);
-			auto strTime = util::get_pretty_duration(tDeltaD / 1'000'000.0);
-			std::stringstream ss;
-			ss << "Progress for job '" << ufile::get_file_from_filename(devInfo.outputPath.GetString()) << "': " << util::round_string(progress * 100.f, 2) << " %";
-			if(progress > 0.f)
-				ss << " Time remaining: " << strTime << ".";
-
-			auto numCompleted = m_numSucceeded + m_numFailed + m_numSkipped;
-			auto totalProgress = (numCompleted + progress) / static_cast<float>(m_numJobs);
-			ss << " Total progress: " << util::round_string(totalProgress * 100.f, 2.f) << "%";
-
-			auto tDeltaAll = std::chrono::high_resolution_clock::now() - m_startTime;
-			auto tDeltaMs = std::chrono::duration_cast<std::chrono::milliseconds>(tDeltaAll);
-			auto timePassed = util::get_pretty_duration(tDeltaMs.count());
-			ss << " Total time passed: " << timePassed;
-
-			auto numComplete = m_numSucceeded + progress;
-			auto numLeft = m_numJobs - m_numFailed - m_numSkipped - numComplete;
-			auto tRemainingMs = (tDeltaMs / numComplete) * numLeft;
-			auto timeRemaining = util::get_pretty_duration(tRemainingMs.count());
-			ss << " Total time remaining: " << timeRemaining;
-			g_logger->info(ss.str());
-		}
+		else if(IsWorker())
+			m_workerChannel->SendLine("progress\t" + std::to_string(progress) + "\t" + devInfo.outputPath.GetString());
+		else
+			LogProgress(devInfo, progress);
 		return;
 	}
 
-	if(job.IsCancelled())
-		g_logger->info("Job has been cancelled!");
-	else if(job.IsSuccessful() == false)
-		g_logger->error("Job has failed!");
+	if(job.IsCancelled() || job.IsSuccessful() == false) {
+		if(job.IsCancelled())
+			g_logger->info("Job has been cancelled!");
+		else
+			g_logger->error("Job has failed!");
+	}
 	else {
 		g_logger->info("Job has been completed successfully!");
-		auto images = job.GetResult().images;
-		auto imgBuf = images.begin()->second;
-
-		g_logger->info("Saving images...");
-		std::optional<std::string> errMsg {};
-		if(m_renderMode == unirender::Scene::RenderMode::BakeDiffuseLighting || m_renderMode == unirender::Scene::RenderMode::BakeDiffuseLightingSeparate) {
-			struct OutputImageInfo {
-				std::string suffix = "";
-				std::shared_ptr<uimg::ImageBuffer> imgBuf;
-			};
-			std::vector<OutputImageInfo> outputImageInfos;
-			if(m_renderMode == unirender::Scene::RenderMode::BakeDiffuseLighting)
-				outputImageInfos.push_back({"", imgBuf});
+		if(m_replay.has_value())
+			m_replayFrames[devInfo.jobName].renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - devInfo.renderStartTime).count();
+		auto output = get_output_info(devInfo);
+		auto layers = job.GetResult();
+		if(IsWorker())
+			SendWorkerResult(output, layers);
+		else {
+			if(m_noiseTarget.has_value())
+				UpdateNoiseTarget(output, layers);
+			SaveResult(output, std::move(layers));
+		}
+	}
+	devInfo.job = {};
+	if(StartNextView(devInfo))
+		return;
+	// The renderer holds its own copy of the scene data, it mustn't stay alive while the next job is being loaded
+	devInfo.renderer = nullptr;
+	devInfo.rtScene = nullptr;
+	ReleaseJobMemory(devInfo.jobName);
+}
+
+static std::string to_mib(uint64_t bytes) { return util::round_string(bytes / (1024.0 * 1024.0), 1); }
+
+void RTJobManager::ReleaseJobMemory(const std::string &jobName)
+{
+	// The scene has just been destroyed, which frees a large number of small allocations. Return the memory
+	// to the OS right away, otherwise the heap gets more and more fragmented over long batches.
+	release_free_memory();
+	auto stats = get_memory_stats();
+	g_logger->info("Memory usage after job '{}' (heap trimmed, {} MiB read buffer kept): {} MiB resident (peak: {} MiB), {} MiB heap in use, {} MiB free heap.", ufile::get_file_from_filename(jobName), to_mib(m_jobReadBuffer.capacity()), to_mib(stats.residentSize), to_mib(stats.peakResidentSize),
+	  to_mib(stats.heapInUse), to_mib(stats.heapFree));
+	if(m_metrics) {
+		RTMetrics::Record record {"job_memory"};
+		record.Add("job", jobName).Add("rss_bytes", stats.residentSize).Add("peak_rss_bytes", stats.peakResidentSize).Add("heap_in_use_bytes", stats.heapInUse).Add("heap_free_bytes", stats.heapFree);
+		record.Add("read_buffer_bytes", static_cast<uint64_t>(m_jobReadBuffer.capacity()));
+		m_metrics->Write(record);
+	}
+}
+
+void RTJobManager::EvaluateReplayFrame(const OutputInfo &output, const uimg::ImageBuffer &imgBuf, double outputMs)
+{
+	auto itJob = std::find_if(m_replay->jobs.begin(), m_replay->jobs.end(), [&output](const ReplayJob &job) { return job.fileName == output.jobName; });
+	if(itJob == m_replay->jobs.end())
+		return;
+	auto &job = *itJob;
+	auto &frame = m_replayFrames[output.jobName];
+	frame.outputMs = outputMs;
+	frame.evaluated = true;
+	auto totalMs = frame.loadMs + frame.sceneMs + frame.renderMs + frame.outputMs;
+
+	std::vector<std::string> failures;
+	std::stringstream checksum;
+	checksum << std::hex << get_image_checksum(imgBuf);
+	RTMetrics::Record record {"replay_frame"};
+	record.Add("job", output.jobName).Add("output", output.outputPath.GetString()).Add("checksum", checksum.str());
+	record.Add("load_ms", frame.loadMs).Add("scene_ms", frame.sceneMs).Add("render_ms", frame.renderMs).Add("output_ms", frame.outputMs).Add("total_ms", totalMs);
+	if(job.reference.empty() == false) {
+		record.Add("reference", job.reference).Add("min_psnr", m_replay->minPsnr);
+		std::shared_ptr<uimg::ImageBuffer> refBuf = nullptr;
+		auto f = filemanager::open_system_file(job.reference, filemanager::FileMode::Read | filemanager::FileMode::Binary);
+		if(f) {
+			fsys::File fp {f};
+			refBuf = uimg::load_image(fp, uimg::PixelFormat::LDR);
+		}
+		if(refBuf == nullptr)
+			failures.push_back("Unable to load reference image '" + job.reference + "'");
+		else {
+			std::stringstream refChecksum;
+			refChecksum << std::hex << get_image_checksum(*refBuf);
+			record.Add("reference_checksum", refChecksum.str());
+			auto psnr = get_image_psnr(imgBuf, *refBuf);
+			if(psnr.has_value() == false)
+				failures.push_back("Resolution doesn't match the reference image");
 			else {
-				outputImageInfos.push_back({"_direct", images["DiffuseDirect"]});
-				outputImageInfos.push_back({"_indirect", images["DiffuseIndirect"]});
-			}
-			for(auto &outputImgInfo : outputImageInfos) {
-				auto path = devInfo.outputPath;
-				path.RemoveFileExtension(std::vector<std::string> {"hdr", "dds"});
-				path += outputImgInfo.suffix;
-
-				if(m_saveAsHdr) {
-					path += ".hdr";
-					auto f = filemanager::open_system_file(path.GetString(), filemanager::FileMode::Write | filemanager::FileMode::Binary);
-					if(!f) {
-						errMsg = "Failed to open output file '" + path.GetString() + "'!";
-						continue;
-					}
-					fsys::File fp {f};
-					if(!uimg::save_image(fp, *outputImgInfo.imgBuf, uimg::ImageFormat::HDR))
-						errMsg = "Unable to save image as '" + devInfo.outputPath.GetString() + "'!";
-					continue;
-				}
-				path += ".dds";
-				uimg::TextureInfo texInfo {};
-				texInfo.containerFormat = uimg::TextureInfo::ContainerFormat::DDS;
-				texInfo.inputFormat = uimg::TextureInfo::InputFormat::R16G16B16A16_Float;
-				texInfo.outputFormat = uimg::TextureInfo::OutputFormat::BC6;
-				texInfo.flags = uimg::TextureInfo::Flags::GenerateMipmaps;
-				uimg::TextureSaveInfo saveInfo {};
-				saveInfo.texInfo = texInfo;
-				if(uimg::save_texture(path.GetString(), *outputImgInfo.imgBuf, saveInfo, nullptr, true) == false)
-					errMsg = "Unable to save image as '" + devInfo.outputPath.GetString() + "'!";
+				// Identical images have an infinite PSNR, which is written as null
+				record.Add("psnr", *psnr).Add("identical", std::isinf(*psnr));
+				if(*psnr < m_replay->minPsnr)
+					failures.push_back("PSNR of " + util::round_string(*psnr, 2) + " dB is below " + util::round_string(m_replay->minPsnr, 2) + " dB");
 			}
 		}
-		else {
-			auto fImg = FileManager::OpenSystemFile(devInfo.outputPath.GetString().c_str(), "wb");
-			if(fImg) {
-				/*auto ocioConfigLocation = util::Path::CreatePath(util::get_program_path());
-				ocioConfigLocation += "../modules/open_color_io/configs/";
-				ocioConfigLocation.Canonicalize();*/
-				switch(m_toneMapping) {
-				case ToneMapping::FilmicBlender:
-					{
-						//std::string err;
-						//if(util::ocio::apply_color_transform(*imgBuf,util::ocio::Config::FilmicBlender,ocioConfigLocation.GetString(),err,m_exposure,m_gamma) == false)
-						//	errMsg = "Unable to apply OCIO color transform: " +err;
-						//imgBuf->ToLDR();
-						//imgBuf->ClearAlpha(std::numeric_limits<uint8_t>::max());
-						break;
-					}
-				}
+	}
+	if(job.baselineMs.has_value()) {
+		auto slowdown = totalMs / umath::max(*job.baselineMs, 1.0);
+		record.Add("baseline_ms", *job.baselineMs).Add("slowdown", slowdown).Add("max_slowdown", m_replay->maxSlowdown);
+		if(slowdown > m_replay->maxSlowdown)
+			failures.push_back("Took " + util::round_string(slowdown, 2) + " times as long as the baseline");
+	}
+	std::string reason;
+	for(auto &failure : failures)
+		reason += (reason.empty() ? "" : "; ") + failure;
+	record.Add("passed", failures.empty());
+	if(failures.empty() == false) {
+		record.Add("reason", reason);
+		++m_numReplayFailures;
+		g_logger->error("Replay of job '{}' has failed: {}", ufile::get_file_from_filename(output.jobName), reason);
+	}
+	else
+		g_logger->info("Replay of job '{}' has passed (load: {:.0f} ms, scene: {:.0f} ms, render: {:.0f} ms, output: {:.0f} ms).", ufile::get_file_from_filename(output.jobName), frame.loadMs, frame.sceneMs, frame.renderMs, frame.outputMs);
+	if(m_replayReport)
+		m_replayReport->Write(record);
+}
 
-				if(errMsg.has_value() == false) {
-					auto result = false;
-					imgBuf->Convert(uimg::Format::RGB_LDR);
-
-					//if(imgBuf->IsHDRFormat() || imgBuf->IsFloatFormat())
-					//	result = uimg::save_image(fImg,*imgBuf,uimg::ImageFormat::HDR);
-					//else
-					fsys::File fp {fImg};
-					result = uimg::save_image(fp, *imgBuf, uimg::ImageFormat::PNG);
-					if(result == false)
-						errMsg = "Unable to save image as '" + devInfo.outputPath.GetString() + "'!";
-				}
-			}
-			if(errMsg.has_value()) {
-				g_logger->error(*errMsg);
-				fImg = nullptr;
-				FileManager::RemoveSystemFile(devInfo.outputPath.GetString().c_str());
-			}
-			else
-				++m_numSucceeded;
+bool RTJobManager::FinishReplay()
+{
+	uint32_t numRendered = 0;
+	for(auto &job : m_replay->jobs) {
+		auto it = m_replayFrames.find(job.fileName);
+		if(it != m_replayFrames.end() && it->second.evaluated) {
+			++numRendered;
+			continue;
+		}
+		++m_numReplayFailures;
+		if(m_replayReport) {
+			RTMetrics::Record record {"replay_frame"};
+			record.Add("job", job.fileName).Add("passed", false).Add("reason", "Job has failed or was skipped");
+			m_replayReport->Write(record);
 		}
 	}
-	devInfo.rtScene = nullptr;
-	devInfo.job = {};
+	auto wallTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - m_startTime).count();
+	auto framesPerHour = (wallTimeMs > 0.0) ? (numRendered / (wallTimeMs / 3'600'000.0)) : 0.0;
+	auto memStats = get_memory_stats();
+	auto rssExceeded = m_replay->maxPeakRss > 0 && memStats.peakResidentSize > m_replay->maxPeakRss;
+	auto passed = m_replayError.empty() && m_numReplayFailures == 0 && rssExceeded == false;
+
+	if(m_replayReport) {
+		RTMetrics::Record record {"replay_summary"};
+		record.Add("jobs", static_cast<uint64_t>(m_replay->jobs.size())).Add("rendered", numRendered).Add("failed", m_numReplayFailures);
+		record.Add("samples", m_replay->samples).Add("width", m_replay->width).Add("height", m_replay->height).Add("device", "CPU");
+		record.Add("wall_time_ms", wallTimeMs).Add("frames_per_hour", framesPerHour).Add("peak_rss_bytes", memStats.peakResidentSize);
+		record.Add("min_psnr", m_replay->minPsnr).Add("max_slowdown", m_replay->maxSlowdown);
+		if(m_replay->maxPeakRss > 0)
+			record.Add("max_peak_rss_bytes", m_replay->maxPeakRss);
+		if(m_replayError.empty() == false)
+			record.Add("error", m_replayError);
+		record.Add("passed", passed);
+		m_replayReport->Write(record);
+	}
+	if(rssExceeded)
+		g_logger->error("Peak memory usage of {} MiB exceeds the limit of {} MiB!", to_mib(memStats.peakResidentSize), to_mib(m_replay->maxPeakRss));
+	g_logger->info("Replay {}: {} of {} jobs rendered, {} failed, {} frames per hour, {} MiB peak memory usage.", passed ? "passed" : "failed", numRendered, m_replay->jobs.size(), m_numReplayFailures, util::round_string(framesPerHour, 1), to_mib(memStats.peakResidentSize));
+	return passed;
 }
 
 void RTJobManager::PrintCommandHelp()
@@ -586,6 +1385,34 @@ void RTJobManager::PrintHelp()
 	ss << "-vertical_camera_range=(0,360]: The vertical range in degrees to use if the camera type is set to \"panorama\".\n";
 	ss << "-color_transform: The color transform to apply to the image.\n";
 	ss << "-color_transform_look: The look of the color transform to apply to the image.\n";
+	ss << "-noise_target=\"<targetNoise> [minSamples] [maxSamples]\": Measures the noise of every rendered frame (on the image as it's returned by the renderer) and adjusts the sample count of the following frames of the same shot (same file name without the frame number) so they reach the target noise level. The first frame of a shot is rendered with maxSamples (or the job's sample count). Jobs that are denoised by the renderer keep their sample count, since the noise of a denoised image can't be measured.\n";
+	ss << "-mount_addons=<dir1,dir2,...>: Only mounts the addons which contain at least one of the specified top-level directories (e.g. \"materials,models\"), so file lookups have to search fewer addons. By default all addons are mounted.\n";
+	ss << "-metrics=<file>: Appends per-frame metrics to the specified file in the JSON lines format.\n";
+	ss << "-hdr_master=<1/0>: Additionally saves the linear HDR image of every frame as \"<output>_master.hdr\", and the job's color transform as \"<output>_master.transform\". The color transform is then applied by this program instead of the renderer, the PNG images are the same as without this option.\n";
+	ss << "-regrade=<directory>: Doesn't render anything, instead re-applies the color transform to all HDR masters in the directory in parallel and overwrites the corresponding PNG images. Uses the color transform the job was rendered with, unless -color_transform and -color_transform_look are specified. -exposure and -gamma are only applied if they're specified.\n";
+	ss << "-compress_jobs=<pattern>: Doesn't render anything, instead compresses all job files matching the pattern (e.g. \"render/shot01/*.prt\"). Compressed job files are loaded automatically, even if the job list still refers to the uncompressed name.\n";
+	ss << "-compression=lz4/zstd: The compression to use for -compress_jobs.\n";
+	ss << "-compression_level=<level>: The compression level to use for -compress_jobs.\n";
+	ss << "-remove_uncompressed: Removes the original job files after they have been compressed with -compress_jobs.\n";
+	ss << "Job files with the extension \".rtdelta\" are scene deltas, which only describe the changes (camera, object transforms, lights) of a frame relative to a base job file. The base scene is only loaded once per device and shot and re-used for all following deltas. All render settings are taken from the base job. With -noise_target, the base scene is reloaded whenever the sample count of the shot changes.\n";
+	ss << "-make_deltas=<pattern>: Doesn't render anything, instead creates a scene delta for every job file matching the pattern (e.g. \"render/shot01/*.prt\"). The first job file (in alphabetical order) becomes the base scene. The deltas are written next to the job files as \"<job name>.rtdelta\", so the images are named after the job files instead of the output names stored in the jobs. Only changes of the camera, object and light transforms and light colors and intensities are detected; if anything else differs between the frames (e.g. meshes, materials, render settings), the job files have to be rendered directly.\n";
+	ss << "-isolate_jobs: Executes every job in a separate worker process (one per device), so a crash or hang of the renderer only affects a single frame. Rendered images are transferred back through shared memory. Only supported on Linux.\n";
+	ss << "-worker_timeout=<seconds>: Kills and restarts a worker if its progress hasn't changed for the specified number of seconds. The timer starts once the worker has loaded the scene and started rendering. Defaults to 1800.\n";
+	ss << "-worker_retries=<count>: The number of times a job is retried after its worker has crashed or timed out. Defaults to 2.\n";
+	ss << "-aovs=all/<layer0,layer1,...>: Additionally writes the auxiliary layers (e.g. albedo, normals, depth) that the renderer returns alongside the image as \"<output>_<layer>\", without rendering the job again.\n";
+	ss << "-aov_format=hdr/png: The image format for -aovs. Defaults to hdr, which keeps the full range of depth and normal values.\n";
+	ss << "-draft=all/spot: Renders a draft of every job (\"all\") or only of the equidistant frames that are rendered first (\"spot\") at reduced resolution and sample count with denoising, before the final pass is started.\n";
+	ss << "-draft_scale=<scale>: Resolution scale of the drafts. Defaults to 0.25.\n";
+	ss << "-draft_samples=<sampleCount>: Number of samples for the drafts. Defaults to 16.\n";
+	ss << "-draft_dir=<directory>: Directory for the drafts, relative to the output directory. Defaults to \"draft/\".\n";
+	ss << "-draft_validate=<command>: Command which is executed for every draft with the path to the image as argument. If it returns a non-zero exit code, or the draft is completely black or contains invalid pixels, the batch is aborted before the final pass. On Windows the command is started directly instead of through cmd.exe, so batch files have to be run with \"cmd /c <file>\".\n";
+	ss << "-replay=<manifest>: Renders the recorded jobs listed in the manifest on the CPU with pinned samples and resolution, and writes per-phase timings, frames per hour, peak memory usage and image checksums to a JSON lines report. "
+	      "Frames are compared against reference images (PSNR) and baseline timings, the program exits with a failure code if a threshold is exceeded. Each line of the manifest is either a setting "
+	      "(samples=<n>, width=<w>, height=<h>, output_dir=<path>, report=<file>, min_psnr=<dB>, max_slowdown=<ratio>, max_peak_rss=<MiB>) or a job (\"<jobFile> [reference=<image>] [baseline_ms=<ms>]\").\n";
+	ss << "-views=<file>: Renders multiple views of every job, using the same scene. Each line of the file describes one view: \"<name> [pos=x,y,z] [ang=p,y,r] [fov=<degrees>] [camera_type=<type>] [panorama_type=<type>] [stereoscopic=<1/0>] [orbit=<yaw>] [center=x,y,z]\". "
+	      "A line \"turntable=<count> [center=x,y,z]\" adds <count> views rotating around the center. The name is appended to the output file name. "
+	      "Positions and angles are relative to the original camera for orbit views, otherwise absolute; camera settings other than the transform carry over to the following views. "
+	      "The job is only loaded and finalized once, but the renderer (including its own scene preparation) is still created for every view.\n";
 	g_logger->info(ss.str());
 }
 
@@ -618,6 +1445,588 @@ void RTJobManager::PrintHeader(const unirender::Scene::CreateInfo &createInfo, c
 	g_logger->info("Max transmission bounces: {}", sceneInfo.maxTransmissionBounces);
 }
 
+// Calls 'f' with every index in [0,count) and the index of the thread that is processing it
+static void run_parallel(size_t count, uint32_t numThreads, const std::function<void(size_t, uint32_t)> &f)
+{
+	std::atomic<size_t> nextIdx = 0;
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads);
+	for(uint32_t i = 0; i < numThreads; ++i) {
+		threads.push_back(std::thread {[&nextIdx, count, &f, i]() {
+			for(auto idx = nextIdx++; idx < count; idx = nextIdx++)
+				f(idx, i);
+		}});
+	}
+	for(auto &thread : threads)
+		thread.join();
+}
+
+static uint32_t get_worker_thread_count(size_t numItems)
+{
+	auto numThreads = umath::max(std::thread::hardware_concurrency(), 1u);
+	return umath::max(umath::min(numThreads, static_cast<uint32_t>(numItems)), 1u);
+}
+
+std::optional<unirender::Scene::ColorTransformInfo> RTJobManager::GetColorTransformOverride() const
+{
+	auto itColorTransform = m_launchParams.find("-color_transform");
+	if(itColorTransform == m_launchParams.end())
+		return {};
+	unirender::Scene::ColorTransformInfo colorTransform {};
+	colorTransform.config = itColorTransform->second;
+
+	auto itLook = m_launchParams.find("-color_transform_look");
+	if(itLook != m_launchParams.end())
+		colorTransform.lookName = itLook->second;
+	return colorTransform;
+}
+
+void RTJobManager::Regrade(const std::string &masterDir)
+{
+	auto path = util::Path::CreatePath(masterDir);
+	std::vector<std::string> masterFiles;
+	FileManager::FindSystemFiles((path.GetString() + "*_master.hdr").c_str(), &masterFiles, nullptr);
+	std::sort(masterFiles.begin(), masterFiles.end());
+	m_numJobs = masterFiles.size();
+	if(masterFiles.empty()) {
+		g_logger->warn("No HDR masters found in '{}'!", path.GetString());
+		return;
+	}
+	auto colorTransformOverride = GetColorTransformOverride();
+	if(colorTransformOverride.has_value() == false)
+		g_logger->info("No color transform specified, the HDR masters will be regraded with the color transform they were rendered with.");
+
+	auto numThreads = get_worker_thread_count(masterFiles.size());
+	g_logger->info("Regrading {} HDR masters using {} threads...", masterFiles.size(), numThreads);
+	auto t = std::chrono::high_resolution_clock::now();
+
+	std::atomic<uint32_t> numSucceeded = 0;
+	std::atomic<uint32_t> numFailed = 0;
+	// Creating a color processor is expensive, so every thread creates its own once per color transform and reuses it for all of its images
+	std::vector<std::unordered_map<std::string, std::shared_ptr<util::ocio::ColorProcessor>>> processors(numThreads);
+	run_parallel(masterFiles.size(), numThreads, [&](size_t i, uint32_t threadIdx) {
+		auto masterPath = path;
+		masterPath += masterFiles[i];
+		auto outputPath = masterPath.GetString();
+		outputPath = outputPath.substr(0, outputPath.length() - std::string {"_master.hdr"}.length()) + ".png";
+
+		auto fMaster = filemanager::open_system_file(masterPath.GetString(), filemanager::FileMode::Read | filemanager::FileMode::Binary);
+		if(fMaster == nullptr) {
+			g_logger->error("Unable to open HDR master '{}'!", masterPath.GetString());
+			++numFailed;
+			return;
+		}
+		fsys::File fpMaster {fMaster};
+		auto imgBuf = uimg::load_image(fpMaster, uimg::PixelFormat::Float);
+		if(imgBuf == nullptr) {
+			g_logger->error("Unable to load HDR master '{}'!", masterPath.GetString());
+			++numFailed;
+			return;
+		}
+		std::string err;
+		auto colorTransform = colorTransformOverride.has_value() ? colorTransformOverride : load_master_color_transform(masterPath.GetString());
+		std::shared_ptr<util::ocio::ColorProcessor> processor = nullptr;
+		if(colorTransform.has_value()) {
+			auto &cachedProcessor = processors[threadIdx][colorTransform->config + "\t" + colorTransform->lookName.value_or("")];
+			if(cachedProcessor == nullptr) {
+				cachedProcessor = create_color_processor(*colorTransform, m_exposure, m_gamma, err);
+				if(cachedProcessor == nullptr) {
+					g_logger->error("Unable to create color processor for '{}': {}", masterPath.GetString(), err);
+					++numFailed;
+					return;
+				}
+			}
+			processor = cachedProcessor;
+		}
+		if(apply_grade(*imgBuf, processor.get(), m_exposure, m_gamma, err) == false) {
+			g_logger->error("Unable to apply color transform to '{}': {}", masterPath.GetString(), err);
+			++numFailed;
+			return;
+		}
+		auto fImg = filemanager::open_system_file(outputPath, filemanager::FileMode::Write | filemanager::FileMode::Binary);
+		if(fImg == nullptr) {
+			g_logger->error("Failed to open output file '{}'!", outputPath);
+			++numFailed;
+			return;
+		}
+		fsys::File fp {fImg};
+		if(uimg::save_image(fp, *imgBuf, uimg::ImageFormat::PNG) == false) {
+			g_logger->error("Unable to save image as '{}'!", outputPath);
+			++numFailed;
+			return;
+		}
+		++numSucceeded;
+	});
+
+	m_numSucceeded = numSucceeded;
+	m_numFailed = numFailed;
+	auto tDelta = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t);
+	g_logger->info("Regrading complete! Time passed: {}", util::get_pretty_duration(tDelta.count()));
+	if(m_metrics) {
+		RTMetrics::Record record {"regrade"};
+		record.Add("directory", path.GetString()).Add("images", static_cast<uint64_t>(masterFiles.size())).Add("succeeded", m_numSucceeded).Add("failed", m_numFailed);
+		record.Add("threads", numThreads).Add("duration_ms", static_cast<int64_t>(tDelta.count()));
+		m_metrics->Write(record);
+	}
+}
+
+void RTJobManager::CompressJobs(const std::string &pattern)
+{
+	auto compression = JobFileCompression::LZ4;
+	auto itCompression = m_launchParams.find("-compression");
+	if(itCompression != m_launchParams.end()) {
+		auto parsedCompression = parse_job_file_compression(itCompression->second);
+		if(parsedCompression.has_value() == false || *parsedCompression == JobFileCompression::None || is_job_file_compression_supported(*parsedCompression) == false) {
+			g_logger->error("Unsupported compression type '{}'!", itCompression->second);
+			return;
+		}
+		compression = *parsedCompression;
+	}
+	int32_t level = 9; // LZ4 HC level 9 and zstd level 9 both decompress at full speed with good ratios
+	auto itLevel = m_launchParams.find("-compression_level");
+	if(itLevel != m_launchParams.end())
+		level = util::to_int(itLevel->second);
+	auto removeUncompressed = (m_launchParams.find("-remove_uncompressed") != m_launchParams.end());
+
+	auto path = ufile::get_path_from_filename(pattern);
+	std::vector<std::string> files;
+	FileManager::FindSystemFiles(pattern.c_str(), &files, nullptr);
+	auto ext = get_job_file_compression_extension(compression);
+	auto it = std::remove_if(files.begin(), files.end(), [](const std::string &file) {
+		std::string fileExt;
+		return ufile::get_extension(file, &fileExt) && (ustring::compare<std::string>(fileExt, "lz4", false) || ustring::compare<std::string>(fileExt, "zst", false) || ustring::compare<std::string>(fileExt, "tmp", false));
+	});
+	files.erase(it, files.end());
+	m_numJobs = files.size();
+	if(files.empty()) {
+		g_logger->warn("No job files found matching '{}'!", pattern);
+		return;
+	}
+	auto numThreads = get_worker_thread_count(files.size());
+	g_logger->info("Compressing {} job files with {} (level {}) using {} threads...", files.size(), magic_enum::enum_name(compression), level, numThreads);
+	auto t = std::chrono::high_resolution_clock::now();
+
+	std::atomic<uint32_t> numSucceeded = 0;
+	std::atomic<uint32_t> numFailed = 0;
+	std::atomic<uint64_t> bytesIn = 0;
+	std::atomic<uint64_t> bytesOut = 0;
+	run_parallel(files.size(), numThreads, [&](size_t i, uint32_t) {
+		auto srcFileName = path + files[i];
+		auto dstFileName = srcFileName + "." + ext;
+		std::string err;
+		if(compress_job_file(srcFileName, dstFileName, compression, level, err) == false) {
+			g_logger->error("Unable to compress job file '{}': {}", srcFileName, err);
+			++numFailed;
+			return;
+		}
+		std::error_code ec;
+		auto srcSize = std::filesystem::file_size(srcFileName, ec);
+		bytesIn += ec ? 0 : srcSize;
+		auto dstSize = std::filesystem::file_size(dstFileName, ec);
+		bytesOut += ec ? 0 : dstSize;
+		if(removeUncompressed)
+			FileManager::RemoveSystemFile(srcFileName.c_str());
+		++numSucceeded;
+	});
+
+	m_numSucceeded = numSucceeded;
+	m_numFailed = numFailed;
+	auto tDelta = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t);
+	auto ratio = (bytesOut > 0) ? (static_cast<double>(bytesIn) / static_cast<double>(bytesOut)) : 0.0;
+	g_logger->info("Compression complete! {} bytes -> {} bytes (ratio {}). Time passed: {}", bytesIn.load(), bytesOut.load(), util::round_string(ratio, 2), util::get_pretty_duration(tDelta.count()));
+	if(m_metrics) {
+		RTMetrics::Record record {"compress_jobs"};
+		record.Add("pattern", pattern).Add("compression", std::string {magic_enum::enum_name(compression)}).Add("level", level);
+		record.Add("files", static_cast<uint64_t>(files.size())).Add("succeeded", m_numSucceeded).Add("failed", m_numFailed);
+		record.Add("bytes_in", bytesIn.load()).Add("bytes_out", bytesOut.load()).Add("duration_ms", static_cast<int64_t>(tDelta.count()));
+		m_metrics->Write(record);
+	}
+}
+
+void RTJobManager::MakeDeltas(const std::string &pattern)
+{
+	auto path = ufile::get_path_from_filename(pattern);
+	std::vector<std::string> files;
+	FileManager::FindSystemFiles(pattern.c_str(), &files, nullptr);
+	auto it = std::remove_if(files.begin(), files.end(), [](const std::string &file) {
+		std::string fileExt;
+		return ufile::get_extension(file, &fileExt)
+		  && (ustring::compare<std::string>(fileExt, "lz4", false) || ustring::compare<std::string>(fileExt, "zst", false) || ustring::compare<std::string>(fileExt, "tmp", false) || ustring::compare<std::string>(fileExt, "rtdelta", false));
+	});
+	files.erase(it, files.end());
+	std::sort(files.begin(), files.end());
+	m_numJobs = files.size();
+	if(files.empty()) {
+		g_logger->warn("No job files found matching '{}'!", pattern);
+		return;
+	}
+	auto &baseFileName = files.front();
+	if(std::find_if(baseFileName.begin(), baseFileName.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }) != baseFileName.end()) {
+		g_logger->error("Base job file '{}' can't be referenced by a scene delta, since its name contains whitespace!", baseFileName);
+		m_numFailed = m_numJobs;
+		return;
+	}
+	g_logger->info("Creating scene deltas for {} job files with base scene '{}'...", files.size(), baseFileName);
+	auto t = std::chrono::high_resolution_clock::now();
+
+	auto loadScene = [this, &path](const std::string &fileName) -> std::shared_ptr<unirender::Scene> {
+		DeviceInfo devInfo {unirender::Scene::DeviceType::CPU};
+		devInfo.jobName = path + fileName;
+		if(LoadScene(devInfo.jobName, devInfo, false) != LoadResult::Success)
+			return nullptr;
+		return devInfo.rtScene;
+	};
+	auto baseScene = loadScene(baseFileName);
+	if(baseScene == nullptr) {
+		g_logger->error("Unable to load base job file '{}'!", baseFileName);
+		m_numFailed = m_numJobs;
+		return;
+	}
+	uint32_t numChanges = 0;
+	for(auto &fileName : files) {
+		auto deltaFileName = fileName;
+		ufile::remove_extension_from_filename(deltaFileName);
+		deltaFileName = path + deltaFileName + ".rtdelta";
+		SceneDelta delta {};
+		delta.baseFileName = baseFileName;
+		std::string err;
+		if(&fileName != &baseFileName) {
+			auto scene = loadScene(fileName);
+			if(scene == nullptr) {
+				++m_numFailed;
+				continue;
+			}
+			if(make_scene_delta(*baseScene, *scene, delta, err) == false) {
+				g_logger->error("Unable to create scene delta for job file '{}': {}", fileName, err);
+				++m_numFailed;
+				continue;
+			}
+		}
+		if(save_scene_delta(deltaFileName, delta, err) == false) {
+			g_logger->error("Unable to save scene delta '{}': {}", deltaFileName, err);
+			++m_numFailed;
+			continue;
+		}
+		numChanges += (delta.camera.has_value() ? 1 : 0) + static_cast<uint32_t>(delta.objects.size() + delta.lights.size());
+		++m_numSucceeded;
+	}
+
+	auto tDelta = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t);
+	g_logger->info("Created {} scene deltas with {} changed cameras, objects and lights. Time passed: {}", m_numSucceeded, numChanges, util::get_pretty_duration(tDelta.count()));
+	if(m_metrics) {
+		RTMetrics::Record record {"make_deltas"};
+		record.Add("pattern", pattern).Add("base", baseFileName).Add("files", static_cast<uint64_t>(files.size())).Add("succeeded", m_numSucceeded).Add("failed", m_numFailed);
+		record.Add("changes", numChanges).Add("duration_ms", static_cast<int64_t>(tDelta.count()));
+		m_metrics->Write(record);
+	}
+}
+
+static std::optional<unirender::Camera::CameraType> parse_camera_type(const std::string &strCamType)
+{
+	if(ustring::compare<std::string>(strCamType, "orthographic", false))
+		return unirender::Camera::CameraType::Orthographic;
+	else if(ustring::compare<std::string>(strCamType, "perspective", false))
+		return unirender::Camera::CameraType::Perspective;
+	else if(ustring::compare<std::string>(strCamType, "panorama", false))
+		return unirender::Camera::CameraType::Panorama;
+	return {};
+}
+
+static std::optional<unirender::Camera::PanoramaType> parse_panorama_type(const std::string &strPanoramaType)
+{
+	if(ustring::compare<std::string>(strPanoramaType, "equirectangular", false))
+		return unirender::Camera::PanoramaType::Equirectangular;
+	else if(ustring::compare<std::string>(strPanoramaType, "fisheye_equidistant", false))
+		return unirender::Camera::PanoramaType::FisheyeEquidistant;
+	else if(ustring::compare<std::string>(strPanoramaType, "fisheye_equisolid", false))
+		return unirender::Camera::PanoramaType::FisheyeEquisolid;
+	else if(ustring::compare<std::string>(strPanoramaType, "mirrorball", false))
+		return unirender::Camera::PanoramaType::Mirrorball;
+	return {};
+}
+
+static std::optional<std::array<float, 3>> parse_float3(const std::string &str)
+{
+	std::vector<std::string> components;
+	ustring::explode(str, ",", components);
+	if(components.size() != 3)
+		return {};
+	return std::array<float, 3> {util::to_float(components[0]), util::to_float(components[1]), util::to_float(components[2])};
+}
+
+bool RTJobManager::LoadViews(const std::string &fileName)
+{
+	auto f = FileManager::OpenSystemFile(fileName.c_str(), "r");
+	if(f == nullptr) {
+		g_logger->error("Unable to open view file '{}'!", fileName);
+		return false;
+	}
+	std::vector<std::string> lines;
+	ustring::explode(f->ReadString(), "\n", lines);
+	uint32_t lineIdx = 0;
+	for(auto &line : lines) {
+		++lineIdx;
+		ustring::remove_whitespace(line);
+		if(line.empty() || line.front() == '#')
+			continue;
+		std::vector<std::string> args;
+		ustring::explode_whitespace(line, args);
+
+		ViewInfo view {};
+		std::optional<uint32_t> turntableCount {};
+		for(auto &arg : args) {
+			auto sep = arg.find('=');
+			if(sep == std::string::npos) {
+				view.name = arg;
+				continue;
+			}
+			auto key = arg.substr(0, sep);
+			auto val = arg.substr(sep + 1);
+			auto invalid = false;
+			if(key == "pos" || key == "ang" || key == "center") {
+				auto v = parse_float3(val);
+				if(v.has_value() == false)
+					invalid = true;
+				else if(key == "pos")
+					view.pos = Vector3 {(*v)[0], (*v)[1], (*v)[2]};
+				else if(key == "ang")
+					view.ang = EulerAngles {(*v)[0], (*v)[1], (*v)[2]};
+				else
+					view.orbitCenter = Vector3 {(*v)[0], (*v)[1], (*v)[2]};
+			}
+			else if(key == "fov")
+				view.fov = util::to_float(val);
+			else if(key == "camera_type")
+				invalid = (view.cameraType = parse_camera_type(val)).has_value() == false;
+			else if(key == "panorama_type")
+				invalid = (view.panoramaType = parse_panorama_type(val)).has_value() == false;
+			else if(key == "stereoscopic")
+				view.stereoscopic = util::to_boolean(val);
+			else if(key == "orbit") {
+				view.orbitYaw = util::to_float(val);
+				if(view.orbitCenter.has_value() == false)
+					view.orbitCenter = Vector3 {};
+			}
+			else if(key == "turntable")
+				turntableCount = util::to_uint(val);
+			else
+				invalid = true;
+			if(invalid)
+				g_logger->warn("Invalid view argument '{}' in line {} of view file '{}'! Ignoring...", arg, lineIdx, fileName);
+		}
+
+		if(turntableCount.has_value()) {
+			if(*turntableCount == 0)
+				continue;
+			auto prefix = view.name.empty() ? std::string {"turntable"} : view.name;
+			for(uint32_t i = 0; i < *turntableCount; ++i) {
+				auto turntableView = view;
+				turntableView.name = prefix + std::to_string(i);
+				turntableView.orbitYaw = (360.f / static_cast<float>(*turntableCount)) * static_cast<float>(i);
+				if(turntableView.orbitCenter.has_value() == false)
+					turntableView.orbitCenter = Vector3 {};
+				m_views.push_back(std::move(turntableView));
+			}
+			continue;
+		}
+		if(view.name.empty())
+			view.name = "view" + std::to_string(m_views.size());
+		m_views.push_back(std::move(view));
+	}
+	if(m_views.empty()) {
+		g_logger->warn("View file '{}' doesn't contain any views!", fileName);
+		return false;
+	}
+	return true;
+}
+
+void RTJobManager::ApplyView(DeviceInfo &devInfo, const ViewInfo &view)
+{
+	auto &cam = devInfo.rtScene->GetCamera();
+	auto pos = devInfo.baseCameraPos;
+	auto rot = devInfo.baseCameraRot;
+	if(view.orbitCenter.has_value()) {
+		auto orbitRot = uquat::create(EulerAngles {0.f, view.orbitYaw, 0.f});
+		pos = *view.orbitCenter + orbitRot * (pos - *view.orbitCenter);
+		rot = orbitRot * rot;
+		if(view.pos.has_value())
+			pos += *view.pos;
+		if(view.ang.has_value())
+			rot = rot * uquat::create(*view.ang);
+	}
+	else {
+		if(view.pos.has_value())
+			pos = *view.pos;
+		if(view.ang.has_value())
+			rot = uquat::create(*view.ang);
+	}
+	cam.SetPos(pos);
+	cam.SetRotation(rot);
+	if(view.fov.has_value())
+		cam.SetFOV(*view.fov);
+	if(view.cameraType.has_value())
+		cam.SetCameraType(*view.cameraType);
+	if(view.panoramaType.has_value())
+		cam.SetPanoramaType(*view.panoramaType);
+	if(view.stereoscopic.has_value())
+		cam.SetStereoscopic(*view.stereoscopic);
+}
+
+static util::Path get_view_output_path(const util::Path &outputPath, const RTJobManager::ViewInfo &view)
+{
+	auto path = outputPath;
+	path.RemoveFileExtension(std::vector<std::string> {"png"});
+	path += "_" + view.name + ".png";
+	return path;
+}
+
+static util::Path get_draft_output_path(const util::Path &outputPath, const std::string &draftDirectory)
+{
+	auto path = util::Path::CreatePath(ufile::get_path_from_filename(outputPath.GetString()));
+	path += draftDirectory;
+	path += ufile::get_file_from_filename(outputPath.GetString());
+	return path;
+}
+
+static util::Path get_replay_output_path(const std::string &outputDir, const std::string &fileName)
+{
+	auto path = util::Path::CreatePath(outputDir);
+	path += ufile::get_file_from_filename(fileName);
+	// The output of a previous replay mustn't cause the job to be skipped
+	std::error_code ec;
+	std::filesystem::remove(path.GetString(), ec);
+	return path;
+}
+
+// Jobs are counted once per view (see CollectJobs), so a job that couldn't be loaded fails all of its views,
+// except for the ones that have already been skipped because their output exists
+uint32_t RTJobManager::GetJobFailureCount(const DeviceInfo &devInfo) const
+{
+	if(m_views.empty())
+		return 1;
+	return static_cast<uint32_t>(devInfo.pendingViews.empty() ? m_views.size() : devInfo.pendingViews.size());
+}
+
+bool RTJobManager::StartNextView(DeviceInfo &devInfo)
+{
+	if(devInfo.rtScene == nullptr)
+		return false;
+	while(devInfo.pendingViews.empty() == false) {
+		if(util::CommandManager::ShouldExit()) {
+			devInfo.pendingViews = {};
+			return false;
+		}
+		auto view = std::move(devInfo.pendingViews.front());
+		devInfo.pendingViews.pop();
+
+		devInfo.outputPath = get_view_output_path(devInfo.baseOutputPath, view);
+		g_logger->info("Starting view '{}' of job '{}'...", view.name, ufile::get_file_from_filename(devInfo.jobName));
+		ApplyView(devInfo, view);
+		devInfo.startTime = std::chrono::high_resolution_clock::now();
+		if(StartRender(devInfo))
+			return true;
+		++m_numFailed;
+	}
+	return false;
+}
+
+// Strips the frame number from the job file name, e.g. "shot01/frame0042.prt" -> "shot01/frame"
+static std::string get_shot_identifier(const std::string &jobFileName)
+{
+	auto name = ufile::get_file_from_filename(jobFileName);
+	ufile::remove_extension_from_filename(name);
+	while(name.empty() == false && std::isdigit(static_cast<unsigned char>(name.back())))
+		name.pop_back();
+	return ufile::get_path_from_filename(jobFileName) + name;
+}
+
+// Estimates the standard deviation of the noise in the luminance of the image, using the method described in
+// "Fast Noise Variance Estimation" (J. Immerkaer, 1996): The image is convolved with a Laplacian difference kernel
+// that cancels out smooth shading. The median of the response is used instead of the mean, so edges and texture
+// detail (which produce large responses on a minority of the pixels) don't get mistaken for noise. Luminance is
+// clamped to [0,1], so the estimate isn't dominated by individual fireflies.
+static std::optional<float> estimate_image_noise(const uimg::ImageBuffer &imgBuf)
+{
+	auto w = imgBuf.GetWidth();
+	auto h = imgBuf.GetHeight();
+	if(w < 3 || h < 3)
+		return {};
+	auto floatBuf = imgBuf.Copy(uimg::Format::RGBA_FLOAT);
+	auto *data = static_cast<const float *>(floatBuf->GetData());
+	std::vector<float> luminance;
+	luminance.resize(static_cast<size_t>(w) * h);
+	for(size_t i = 0; i < luminance.size(); ++i) {
+		auto *px = data + i * 4;
+		luminance[i] = umath::clamp(0.2126f * px[0] + 0.7152f * px[1] + 0.0722f * px[2], 0.f, 1.f);
+	}
+	auto get = [&luminance, w](uint32_t x, uint32_t y) -> double { return luminance[static_cast<size_t>(y) * w + x]; };
+	std::vector<float> responses;
+	responses.reserve(static_cast<size_t>(w - 2) * (h - 2));
+	for(uint32_t y = 1; y < h - 1; ++y) {
+		for(uint32_t x = 1; x < w - 1; ++x) {
+			auto v = get(x - 1, y - 1) - 2.0 * get(x, y - 1) + get(x + 1, y - 1) - 2.0 * get(x - 1, y) + 4.0 * get(x, y) - 2.0 * get(x + 1, y) + get(x - 1, y + 1) - 2.0 * get(x, y + 1) + get(x + 1, y + 1);
+			responses.push_back(static_cast<float>(std::abs(v)));
+		}
+	}
+	auto itMedian = responses.begin() + responses.size() / 2;
+	std::nth_element(responses.begin(), itMedian, responses.end());
+	// For gaussian noise the response has a standard deviation of 6 sigma, and the median of its absolute value is 0.6745 times that
+	return static_cast<float>(*itMedian / (6.0 * 0.6745));
+}
+
+void RTJobManager::ApplyNoiseTarget(const std::string &jobFileName, unirender::Scene::CreateInfo &createInfo, DeviceInfo &devInfo)
+{
+	devInfo.shotId = get_shot_identifier(jobFileName);
+	auto maxSamples = m_noiseTarget->maxSamples.has_value() ? m_noiseTarget->maxSamples : createInfo.samples;
+	if(maxSamples.has_value() == false) {
+		g_logger->warn("Job '{}' has no sample count and no maximum sample count was specified for the noise target! Sample count will not be adjusted.", ufile::get_file_from_filename(jobFileName));
+		return;
+	}
+	devInfo.maxSamples = umath::max(*maxSamples, m_noiseTarget->minSamples);
+	auto it = m_shotSampleCounts.find(devInfo.shotId);
+	createInfo.samples = (it != m_shotSampleCounts.end()) ? it->second : *devInfo.maxSamples;
+	devInfo.samples = createInfo.samples;
+	g_logger->info("Using {} samples for job '{}' (noise target: {}).", *createInfo.samples, ufile::get_file_from_filename(jobFileName), m_noiseTarget->targetNoise);
+}
+
+void RTJobManager::UpdateNoiseTarget(const OutputInfo &output, const uimg::ImageLayerSet &layers)
+{
+	if(output.samples.has_value() == false || output.maxSamples.has_value() == false || is_lightmap_bake(output.renderMode))
+		return;
+	auto beautyLayer = find_beauty_layer(layers);
+	if(beautyLayer.has_value() == false)
+		return;
+	// Measured on the image as it was returned by the renderer, the output isn't changed in any way for this
+	auto noise = estimate_image_noise(*layers.images.at(*beautyLayer));
+	if(noise.has_value() == false)
+		return;
+	// Monte Carlo noise falls off with the square root of the sample count
+	auto samples = *output.samples;
+	auto ratio = static_cast<double>(*noise) / static_cast<double>(m_noiseTarget->targetNoise);
+	auto requiredSamples = umath::clamp(std::ceil(samples * ratio * ratio), static_cast<double>(m_noiseTarget->minSamples), static_cast<double>(*output.maxSamples));
+	auto nextSamples = static_cast<uint32_t>(requiredSamples);
+
+	// If the frame was too noisy we'll go straight to the required sample count, otherwise
+	// we'll only reduce it half-way to avoid undershooting because of a single clean frame.
+	auto it = m_shotSampleCounts.find(output.shotId);
+	auto prevSamples = (it != m_shotSampleCounts.end()) ? it->second : *output.maxSamples;
+	if(nextSamples < prevSamples)
+		nextSamples = prevSamples - (prevSamples - nextSamples) / 2;
+	m_shotSampleCounts[output.shotId] = nextSamples;
+
+	auto samplesSaved = *output.maxSamples - samples;
+	m_numSamplesSaved += samplesSaved;
+	auto jobName = ufile::get_file_from_filename(output.jobName);
+	g_logger->info("Estimated noise for job '{}': {} ({} samples, target: {}). Using {} samples for following frames of shot.", jobName, *noise, samples, m_noiseTarget->targetNoise, nextSamples);
+	if(m_metrics) {
+		RTMetrics::Record record {"noise_target"};
+		record.Add("job", output.jobName).Add("shot", output.shotId).Add("estimated_noise", static_cast<double>(*noise)).Add("target_noise", static_cast<double>(m_noiseTarget->targetNoise));
+		record.Add("samples", samples).Add("max_samples", *output.maxSamples).Add("samples_saved", samplesSaved).Add("next_samples", nextSamples);
+		record.Add("total_samples_saved", m_numSamplesSaved);
+		m_metrics->Write(record);
+	}
+}
+
 static unirender::PMesh create_test_box_mesh(unirender::Scene &rtScene, float r = 50.f)
 {
 	Vector3 cmin {-r, -r, -r};
@@ -682,19 +2091,177 @@ static unirender::PMesh create_test_box_mesh(unirender::Scene &rtScene, float r
 	return mesh;
 }
 
-bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
+bool RTJobManager::StartDeltaJob(const std::string &jobFileName, DeviceInfo &devInfo)
 {
-	auto jobFileName = jobName;
-	auto f = FileManager::OpenSystemFile(jobFileName.c_str(), "rb");
-	if(f == nullptr) {
+	auto tParse = std::chrono::high_resolution_clock::now();
+	SceneDelta delta {};
+	std::string err;
+	if(load_scene_delta(jobFileName, delta, err) == false) {
+		g_logger->error("Unable to load scene delta '{}': {}", jobFileName, err);
+		m_numFailed += GetJobFailureCount(devInfo);
+		return false;
+	}
+	auto parseMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tParse).count();
+	auto fileName = ufile::get_file_from_filename(jobFileName);
+	ufile::remove_extension_from_filename(fileName);
+	auto outputPath = util::Path::CreatePath(ufile::get_path_from_filename(jobFileName));
+	outputPath += fileName + ".png";
+	if(devInfo.draft)
+		outputPath = get_draft_output_path(outputPath, m_draft->directory);
+	if(m_replay.has_value())
+		outputPath = get_replay_output_path(m_replay->outputDir, fileName + ".png");
+	if(PrepareOutput(jobFileName, outputPath, devInfo) == false)
+		return false;
+
+	auto t = std::chrono::high_resolution_clock::now();
+	auto baseFileName = ufile::get_path_from_filename(jobFileName) + delta.baseFileName;
+	auto &cache = devInfo.deltaBaseScene;
+	// The remaining render settings (denoising, color transform, -tonemapped) only depend on the base job and the launch parameters,
+	// but the sample count of the noise target is baked into the scene, so the base scene has to be reloaded if it has changed
+	std::optional<uint32_t> samples {};
+	if(cache.maxSamples.has_value()) {
+		auto it = m_shotSampleCounts.find(get_shot_identifier(jobFileName));
+		samples = (it != m_shotSampleCounts.end()) ? it->second : *cache.maxSamples;
+	}
+	auto cacheHit = (cache.scene != nullptr && cache.fileName == baseFileName && cache.draft == devInfo.draft && cache.samples == samples);
+	auto tApply = t;
+	if(cacheHit) {
+		// Revert the changes of the previous delta
+		cache.scene->GetCamera().SetPos(cache.cameraPos);
+		cache.scene->GetCamera().SetRotation(cache.cameraRot);
+		for(auto it = cache.restoreState.rbegin(); it != cache.restoreState.rend(); ++it)
+			(*it)();
+		cache.restoreState.clear();
+		devInfo.rtScene = cache.scene;
+		devInfo.rendererName = cache.rendererName;
+		devInfo.renderMode = cache.renderMode;
+		devInfo.colorTransform = cache.colorTransform;
+		devInfo.applyColorTransform = cache.applyColorTransform;
+		if(cache.maxSamples.has_value()) {
+			devInfo.shotId = get_shot_identifier(jobFileName);
+			devInfo.samples = cache.samples;
+			devInfo.maxSamples = cache.maxSamples;
+		}
+		g_logger->info("Applying scene delta '{}' to cached base scene '{}'...", fileName, ufile::get_file_from_filename(baseFileName));
+	}
+	else {
+		cache = {};
+		auto numFailed = m_numFailed;
+		if(LoadScene(baseFileName, devInfo, false) != LoadResult::Success) {
+			if(m_numFailed > numFailed)
+				m_numFailed = numFailed + GetJobFailureCount(devInfo);
+			devInfo.rtScene = nullptr;
+			return false;
+		}
+		cache.fileName = baseFileName;
+		cache.scene = devInfo.rtScene;
+		cache.rendererName = devInfo.rendererName;
+		cache.renderMode = devInfo.renderMode;
+		cache.colorTransform = devInfo.colorTransform;
+		cache.applyColorTransform = devInfo.applyColorTransform;
+		cache.draft = devInfo.draft;
+		cache.samples = devInfo.samples;
+		cache.maxSamples = devInfo.maxSamples;
+		cache.cameraPos = cache.scene->GetCamera().GetPos();
+		cache.cameraRot = cache.scene->GetCamera().GetRotation();
+		tApply = std::chrono::high_resolution_clock::now();
+	}
+	auto missing = apply_scene_delta(*cache.scene, delta, cache.restoreState);
+	for(auto &name : missing)
+		g_logger->warn("Object or light '{}' of scene delta '{}' doesn't exist in base scene! Ignoring...", name, fileName);
+	if(m_replay.has_value()) {
+		// On a cache miss, LoadScene has already recorded the time it took to load the base scene for this job
+		auto &frame = m_replayFrames[devInfo.jobName];
+		if(cacheHit)
+			frame = {};
+		frame.loadMs += parseMs;
+		frame.sceneMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tApply).count();
+	}
+
+	auto tDelta = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t);
+	if(m_metrics) {
+		RTMetrics::Record record {"delta_load"};
+		record.Add("job", jobFileName).Add("base", baseFileName).Add("cache_hit", cacheHit).Add("load_time_ms", static_cast<int64_t>(tDelta.count()));
+		m_metrics->Write(record);
+	}
+	devInfo.startTime = std::chrono::high_resolution_clock::now();
+	return StartScene(devInfo);
+}
+
+bool RTJobManager::StartJob(const JobInfo &job, DeviceInfo &devInfo)
+{
+	auto &jobName = job.fileName;
+	devInfo.jobName = jobName;
+	devInfo.draft = job.draft;
+	devInfo.shotId = {};
+	devInfo.samples = {};
+	devInfo.maxSamples = {};
+	devInfo.pendingViews = {};
+	if(is_scene_delta_file(jobName))
+		return StartDeltaJob(jobName, devInfo);
+	auto numFailed = m_numFailed;
+	auto result = LoadScene(jobName, devInfo, true);
+	if(result == LoadResult::Failed && m_numFailed > numFailed)
+		m_numFailed = numFailed + GetJobFailureCount(devInfo);
+	return (result == LoadResult::Success) ? StartScene(devInfo) : (result == LoadResult::HeaderOnly);
+}
+
+bool RTJobManager::PrepareOutput(const std::string &jobFileName, const util::Path &outputPath, DeviceInfo &devInfo)
+{
+	if(devInfo.draft) {
+		std::error_code ec;
+		std::filesystem::create_directories(ufile::get_path_from_filename(outputPath.GetString()), ec);
+	}
+	devInfo.outputPath = outputPath;
+	devInfo.pendingViews = {};
+	devInfo.baseOutputPath = outputPath;
+	if(m_views.empty() == false) {
+		for(auto &view : m_views) {
+			auto viewOutputPath = get_view_output_path(outputPath, view);
+			if(FileManager::ExistsSystem(viewOutputPath.GetString())) {
+				g_logger->info("Output file '{}' for view '{}' of job '{}' already exists! Skipping...", viewOutputPath.GetString(), view.name, ufile::get_file_from_filename(jobFileName));
+				++m_numSkipped;
+				continue;
+			}
+			devInfo.pendingViews.push(view);
+		}
+		return devInfo.pendingViews.empty() == false;
+	}
+	if(FileManager::ExistsSystem(outputPath.GetString())) {
+		g_logger->info("Output file '{}' for job '{}' already exists! Skipping...", outputPath.GetString(), ufile::get_file_from_filename(jobFileName));
+		++m_numSkipped;
+		return false;
+	}
+	return true;
+}
+
+RTJobManager::LoadResult RTJobManager::LoadScene(const std::string &jobFileName, DeviceInfo &devInfo, bool determineOutputPath)
+{
+	auto jobFilePath = find_job_file(jobFileName);
+	if(jobFilePath.has_value() == false) {
 		g_logger->error("Job file '{}' not found!", jobFileName);
 		++m_numFailed;
-		return false;
+		return LoadResult::Failed;
+	}
+	auto tLoad = std::chrono::high_resolution_clock::now();
+	JobFileLoadInfo loadInfo {};
+	std::string loadErr;
+	auto optDs = load_job_file(*jobFilePath, loadInfo, loadErr, m_jobReadBuffer);
+	if(optDs.has_value() == false) {
+		g_logger->error("Unable to load job file '{}': {}", *jobFilePath, loadErr);
+		++m_numFailed;
+		return LoadResult::Failed;
+	}
+	auto &ds = *optDs;
+	auto tScene = std::chrono::high_resolution_clock::now();
+	auto tLoadDelta = std::chrono::duration_cast<std::chrono::milliseconds>(tScene - tLoad);
+	g_logger->info("Loaded job file '{}' ({} bytes read, {} bytes uncompressed) in {}.", ufile::get_file_from_filename(*jobFilePath), loadInfo.bytesRead, loadInfo.uncompressedSize, util::get_pretty_duration(tLoadDelta.count()));
+	if(m_metrics) {
+		RTMetrics::Record record {"job_load"};
+		record.Add("job", jobFileName).Add("file", *jobFilePath).Add("compression", std::string {magic_enum::enum_name(loadInfo.compression)});
+		record.Add("bytes_read", loadInfo.bytesRead).Add("uncompressed_size", loadInfo.uncompressedSize).Add("load_time_ms", static_cast<int64_t>(tLoadDelta.count()));
+		m_metrics->Write(record);
 	}
-	auto sz = f->GetSize();
-	DataStream ds {static_cast<uint32_t>(sz)};
-	ds->SetOffset(0);
-	f->Read(ds->GetData(), sz);
 
 	unirender::Scene::RenderMode renderMode;
 	unirender::Scene::CreateInfo createInfo;
@@ -707,23 +2274,24 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 		if(printHeader) {
 			g_logger->info("Header information for job '{}':", ufile::get_file_from_filename(jobFileName));
 			PrintHeader(createInfo, sceneInfo);
-			return true;
+			return LoadResult::HeaderOnly;
 		}
 
-		std::string fileName = serializationData.outputFileName;
-		ufile::remove_extension_from_filename(fileName);
-		//if(m_toneMapping == ToneMapping::None)
-		//	fileName += ".hdr";
-		//else
-		fileName += ".png";
-		auto &outputPath = devInfo.outputPath;
-		outputPath = util::Path::CreatePath(ufile::get_path_from_filename(jobFileName));
-		outputPath += ufile::get_file_from_filename(fileName); // TODO: Only write file name in the first place
-
-		if(FileManager::ExistsSystem(outputPath.GetString())) {
-			g_logger->info("Output file '{}' for job '{}' already exists! Skipping...", outputPath.GetString(), ufile::get_file_from_filename(jobFileName));
-			++m_numSkipped;
-			return false;
+		if(determineOutputPath) {
+			std::string fileName = serializationData.outputFileName;
+			ufile::remove_extension_from_filename(fileName);
+			//if(m_toneMapping == ToneMapping::None)
+			//	fileName += ".hdr";
+			//else
+			fileName += ".png";
+			auto outputPath = util::Path::CreatePath(ufile::get_path_from_filename(jobFileName));
+			outputPath += ufile::get_file_from_filename(fileName); // TODO: Only write file name in the first place
+			if(devInfo.draft)
+				outputPath = get_draft_output_path(outputPath, m_draft->directory);
+			if(m_replay.has_value())
+				outputPath = get_replay_output_path(m_replay->outputDir, fileName);
+			if(PrepareOutput(jobFileName, outputPath, devInfo) == false)
+				return LoadResult::Skipped;
 		}
 
 		g_logger->info("Initializing job '{}'...", jobFileName);
@@ -745,20 +2313,28 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 		if(itSamples != m_launchParams.end())
 			createInfo.samples = ustring::to_int(itSamples->second);
 
-		auto itColorTransform = m_launchParams.find("-color_transform");
-		if(itColorTransform != m_launchParams.end()) {
-			createInfo.colorTransform = unirender::Scene::ColorTransformInfo {};
-			createInfo.colorTransform->config = itColorTransform->second;
-
-			auto itLook = m_launchParams.find("-color_transform_look");
-			if(itLook != m_launchParams.end())
-				createInfo.colorTransform->lookName = itLook->second;
-		}
+		auto colorTransform = GetColorTransformOverride();
+		if(colorTransform.has_value())
+			createInfo.colorTransform = colorTransform;
 
 		auto itDenoise = m_launchParams.find("-denoise");
 		if(itDenoise != m_launchParams.end())
 			createInfo.denoiseMode = util::to_boolean(itDenoise->second) ? unirender::Scene::DenoiseMode::AutoDetailed : unirender::Scene::DenoiseMode::AutoFast;
 
+		if(devInfo.draft) {
+			createInfo.samples = m_draft->samples;
+			if(createInfo.denoiseMode == unirender::Scene::DenoiseMode::None)
+				createInfo.denoiseMode = unirender::Scene::DenoiseMode::AutoFast;
+		}
+
+		if(m_noiseTarget.has_value() && devInfo.draft == false) {
+			// The noise can't be measured once the renderer has denoised the image
+			if(createInfo.denoiseMode == unirender::Scene::DenoiseMode::None)
+				ApplyNoiseTarget(devInfo.jobName, createInfo, devInfo);
+			else
+				g_logger->warn("Job '{}' is denoised by the renderer, so its noise can't be measured! Sample count will not be adjusted.", ufile::get_file_from_filename(devInfo.jobName));
+		}
+
 		auto itAdaptiveSampling = m_launchParams.find("-adaptiveSampling");
 		if(itAdaptiveSampling != m_launchParams.end()) {
 			auto &enabled = sceneInfo.useAdaptiveSampling;
@@ -786,6 +2362,17 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 		if(itTonemapped != m_launchParams.end())
 			createInfo.hdrOutput = false;
 
+		devInfo.colorTransform = {};
+		devInfo.applyColorTransform = false;
+		if(m_saveHdrMasters && devInfo.draft == false && renderMode == unirender::Scene::RenderMode::RenderImage) {
+			// The master has to be the untransformed HDR image. The job's color transform is applied by us when the PNG is
+			// derived from it, the result is the same as with -tonemapped or the renderer's own color transform.
+			devInfo.colorTransform = createInfo.colorTransform;
+			devInfo.applyColorTransform = true;
+			createInfo.colorTransform = {};
+			createInfo.hdrOutput = true;
+		}
+
 		auto itLog = m_launchParams.find("-log");
 		if(itLog == m_launchParams.end() || util::to_boolean(itLog->second) == false)
 			unirender::set_log_handler();
@@ -808,9 +2395,9 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 	if(rtScene == nullptr) {
 		g_logger->error("Unable to create scene from serialized data!");
 		++m_numFailed;
-		return false;
+		return LoadResult::Failed;
 	}
-	m_renderMode = renderMode;
+	devInfo.renderMode = renderMode;
 
 	uint32_t width, height;
 	rtScene->GetCamera().GetResolution(width, height);
@@ -827,30 +2414,14 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 
 	auto itCamType = m_launchParams.find("-camera_type");
 	if(itCamType != m_launchParams.end()) {
-		auto &strCamType = itCamType->second;
-		std::optional<unirender::Camera::CameraType> camType {};
-		if(ustring::compare<std::string>(strCamType, "orthographic", false))
-			camType = unirender::Camera::CameraType::Orthographic;
-		else if(ustring::compare<std::string>(strCamType, "perspective", false))
-			camType = unirender::Camera::CameraType::Perspective;
-		else if(ustring::compare<std::string>(strCamType, "panorama", false))
-			camType = unirender::Camera::CameraType::Panorama;
+		auto camType = parse_camera_type(itCamType->second);
 		if(camType.has_value())
 			rtScene->GetCamera().SetCameraType(*camType);
 	}
 
 	auto itPanoramaType = m_launchParams.find("-panorama_type");
 	if(itPanoramaType != m_launchParams.end()) {
-		auto &strPanoramaType = itPanoramaType->second;
-		std::optional<unirender::Camera::PanoramaType> panoramaType {};
-		if(ustring::compare<std::string>(strPanoramaType, "equirectangular", false))
-			panoramaType = unirender::Camera::PanoramaType::Equirectangular;
-		else if(ustring::compare<std::string>(strPanoramaType, "fisheye_equidistant", false))
-			panoramaType = unirender::Camera::PanoramaType::FisheyeEquidistant;
-		else if(ustring::compare<std::string>(strPanoramaType, "fisheye_equisolid", false))
-			panoramaType = unirender::Camera::PanoramaType::FisheyeEquisolid;
-		else if(ustring::compare<std::string>(strPanoramaType, "mirrorball", false))
-			panoramaType = unirender::Camera::PanoramaType::Mirrorball;
+		auto panoramaType = parse_panorama_type(itPanoramaType->second);
 		if(panoramaType.has_value())
 			rtScene->GetCamera().SetPanoramaType(*panoramaType);
 	}
@@ -875,6 +2446,10 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 	auto itHeight = m_launchParams.find("-height");
 	if(itHeight != m_launchParams.end())
 		height = util::to_int(itHeight->second);
+	if(devInfo.draft) {
+		width = umath::max(static_cast<uint32_t>(std::round(width * m_draft->resolutionScale)), 2u);
+		height = umath::max(static_cast<uint32_t>(std::round(height * m_draft->resolutionScale)), 2u);
+	}
 	if((width % 2) != 0)
 		width += 1;
 	if((height % 2) != 0)
@@ -895,14 +2470,56 @@ bool RTJobManager::StartJob(const std::string &jobName, DeviceInfo &devInfo)
 	devInfo.startTime = std::chrono::high_resolution_clock::now();
 
 	rtScene->Finalize();
+	devInfo.rtScene = rtScene;
+	devInfo.rendererName = createInfo.renderer;
+	if(m_replay.has_value()) {
+		// For delta jobs, the base scene is loaded under the name of the delta
+		auto &frame = m_replayFrames[devInfo.jobName];
+		frame = {};
+		frame.loadMs = std::chrono::duration<double, std::milli>(tScene - tLoad).count();
+		frame.sceneMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tScene).count();
+	}
+	return LoadResult::Success;
+}
+
+bool RTJobManager::StartScene(DeviceInfo &devInfo)
+{
+	auto &rtScene = devInfo.rtScene;
+	if(devInfo.pendingViews.empty() == false) {
+		// The job only has to be loaded and the scene only finalized once, all views are rendered from the same scene
+		devInfo.baseCameraPos = rtScene->GetCamera().GetPos();
+		devInfo.baseCameraRot = rtScene->GetCamera().GetRotation();
+		if(StartNextView(devInfo))
+			return true;
+		devInfo.rtScene = nullptr;
+		return false;
+	}
+	if(StartRender(devInfo) == false) {
+		++m_numFailed;
+		devInfo.rtScene = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool RTJobManager::StartRender(DeviceInfo &devInfo)
+{
 	std::string errMsg;
-	devInfo.renderer = unirender::Renderer::Create(*rtScene, createInfo.renderer, errMsg, unirender::Renderer::Flags::DisableDisplayDriver);
+	// The renderer takes a copy of the scene (including the camera) when it's created, so it has to be recreated for every view.
+	// Its own scene preparation (e.g. building the BVH) is therefore paid per view, only loading and finalizing the scene is shared.
+	auto t = std::chrono::steady_clock::now();
+	devInfo.renderer = unirender::Renderer::Create(*devInfo.rtScene, devInfo.rendererName, errMsg, unirender::Renderer::Flags::DisableDisplayDriver);
 	if(devInfo.renderer == nullptr) {
 		g_logger->error("Failed to create renderer: {}!", errMsg);
 		return false;
 	}
-	if(devInfo.renderer == nullptr)
-		return false;
+	if(m_metrics) {
+		RTMetrics::Record record {"renderer_create"};
+		record.Add("job", devInfo.jobName).Add("output", devInfo.outputPath.GetString());
+		record.Add("create_time_ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count());
+		m_metrics->Write(record);
+	}
+	devInfo.renderStartTime = std::chrono::steady_clock::now();
 	devInfo.job = devInfo.renderer->StartRender();
 	devInfo.job->Start();
 	return true;
@@ -915,13 +2532,337 @@ bool RTJobManager::StartNextJob()
 {
 	if(m_jobQueue.empty())
 		return false;
-	auto itDev = std::find_if(m_devices.begin(), m_devices.end(), [](const DeviceInfo &devInfo) { return devInfo.job.has_value() == false; });
+	auto itDev = std::find_if(m_devices.begin(), m_devices.end(), [](const DeviceInfo &devInfo) { return is_device_busy(devInfo) == false; });
 	if(itDev == m_devices.end())
 		return false; // All devices in use
-	auto &job = m_jobQueue.front();
-	auto success = StartJob(job, *itDev);
-	m_jobQueue.pop();
-	return success;
+	auto job = m_jobQueue.front();
+	// A flagged draft has to be able to abort the batch before the final pass starts
+	if(job.draft == false && m_draft.has_value() && IsDraftPending())
+		return false;
+	m_jobQueue.pop_front();
+	return m_isolateJobs ? StartWorkerJob(job, *itDev) : StartJob(job, *itDev);
+}
+
+int RTJobManager::RunWorker()
+{
+	auto &devInfo = m_devices.front();
+	std::string line;
+	while(m_workerChannel->ReadLine(line)) {
+		std::vector<std::string> args;
+		ustring::explode(line, "\t", args);
+		if(args.empty())
+			continue;
+		auto &cmd = args.front();
+		if(cmd == "shot_samples" && args.size() >= 3)
+			m_shotSampleCounts[args[1]] = util::to_uint(args[2]);
+		else if(cmd == "job" && args.size() >= 2) {
+			auto numSkipped = m_numSkipped;
+			auto numFailed = m_numFailed;
+			JobInfo job {args[1]};
+			for(size_t i = 2; i < args.size(); ++i) {
+				if(args[i] == "draft")
+					job.draft = true;
+			}
+			StartJob(job, devInfo);
+			if(devInfo.job.has_value())
+				m_workerChannel->SendLine("rendering");
+			while(devInfo.job.has_value()) {
+				UpdateJob(devInfo);
+				if(devInfo.job.has_value())
+					std::this_thread::sleep_for(std::chrono::seconds {1});
+			}
+			m_workerChannel->SendLine("finished\t" + std::to_string(m_numSkipped - numSkipped) + "\t" + std::to_string(m_numFailed - numFailed));
+		}
+		else if(cmd == "quit")
+			break;
+	}
+	return EXIT_SUCCESS;
+}
+
+static uint16_t float_to_half(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	uint16_t sign = (bits >> 16) & 0x8000u;
+	auto absBits = bits & 0x7fffffffu;
+	if(absBits > 0x7f800000u)
+		return sign | 0x7e00u; // NaN
+	if(absBits >= 0x477ff000u)
+		return sign | 0x7bffu; // Values that are too large for half precision (including infinity) are clamped to 65504
+	if(absBits < 0x38800000u) {
+		float absF;
+		memcpy(&absF, &absBits, sizeof(absF));
+		return sign | static_cast<uint16_t>(std::nearbyint(absF * 16777216.f)); // Subnormal, in units of 2^-24
+	}
+	// Round to nearest even
+	auto rebiased = absBits - 0x38000000u;
+	return sign | static_cast<uint16_t>((rebiased + 0x0fffu + ((rebiased >> 13) & 1u)) >> 13);
+}
+
+// The format the rendered image is transferred to the supervisor in. Half precision is sufficient for everything the supervisor
+// does with it (8-bit PNG, RGBE HDR and BC6H DDS output, noise estimation), and radiance above 65504 is beyond the range of
+// any color transform. Auxiliary layers and depth or normal renders keep their full range.
+static uimg::Format get_worker_result_format(uimg::Format format)
+{
+	switch(format) {
+	case uimg::Format::RGBA_FLOAT:
+		return uimg::Format::RGBA_HDR;
+	case uimg::Format::RGB_FLOAT:
+		return uimg::Format::RGB_HDR;
+	default:
+		return format;
+	}
+}
+
+void RTJobManager::SendWorkerResult(const OutputInfo &output, const uimg::ImageLayerSet &result)
+{
+	constexpr size_t alignment = 64;
+	auto beautyLayer = find_beauty_layer(result);
+	auto getTransferFormat = [&output, &beautyLayer](const std::string &name, const uimg::ImageBuffer &imgBuf) {
+		auto isImage = (output.renderMode == unirender::Scene::RenderMode::RenderImage && beautyLayer.has_value() && name == *beautyLayer);
+		return isImage ? get_worker_result_format(imgBuf.GetFormat()) : imgBuf.GetFormat();
+	};
+	auto getTransferSize = [&getTransferFormat](const std::string &name, const uimg::ImageBuffer &imgBuf) { return (getTransferFormat(name, imgBuf) != imgBuf.GetFormat()) ? (imgBuf.GetSize() / 2) : imgBuf.GetSize(); };
+	size_t size = 0;
+	for(auto &[name, imgBuf] : result.images)
+		size += (getTransferSize(name, *imgBuf) + alignment - 1) / alignment * alignment;
+	std::string segmentName;
+	auto segment = SharedMemorySegment::Create(size, segmentName);
+	if(segment == nullptr) {
+		g_logger->error("Unable to create shared memory segment for result of job '{}'!", output.jobName);
+		++m_numFailed;
+		return;
+	}
+	std::stringstream ss;
+	ss << "result\t" << segmentName << "\toutput=" << output.outputPath.GetString() << "\tjob=" << output.jobName << "\trender_mode=" << umath::to_integral(output.renderMode);
+	ss << "\tapply_color_transform=" << output.applyColorTransform << "\tdraft=" << output.draft;
+	if(output.samples.has_value() && output.maxSamples.has_value())
+		ss << "\tshot=" << output.shotId << "\tsamples=" << *output.samples << "\tmax_samples=" << *output.maxSamples;
+	if(output.colorTransform.has_value()) {
+		ss << "\tcolor_transform=" << output.colorTransform->config;
+		if(output.colorTransform->lookName.has_value())
+			ss << "\tlook=" << *output.colorTransform->lookName;
+	}
+	// The renderer owns the memory of its images, so they're converted straight into the segment instead
+	size_t offset = 0;
+	for(auto &[name, imgBuf] : result.images) {
+		auto imgSize = getTransferSize(name, *imgBuf);
+		auto format = getTransferFormat(name, *imgBuf);
+		auto *dst = static_cast<uint8_t *>(segment->GetData()) + offset;
+		if(format != imgBuf->GetFormat()) {
+			auto *src = static_cast<const float *>(imgBuf->GetData());
+			auto *dstHalf = reinterpret_cast<uint16_t *>(dst);
+			auto numValues = imgBuf->GetSize() / sizeof(float);
+			for(size_t i = 0; i < numValues; ++i)
+				dstHalf[i] = float_to_half(src[i]);
+		}
+		else
+			memcpy(dst, imgBuf->GetData(), imgSize); // Nothing to convert, e.g. if the renderer has already applied the color transform or for depth layers
+		ss << "\timage=" << name << "," << imgBuf->GetWidth() << "," << imgBuf->GetHeight() << "," << umath::to_integral(format) << "," << offset << "," << imgSize;
+		offset += (imgSize + alignment - 1) / alignment * alignment;
+	}
+	m_workerChannel->SendLine(ss.str());
+}
+
+bool RTJobManager::StartWorkerJob(const JobInfo &job, DeviceInfo &devInfo)
+{
+	auto &jobName = job.fileName;
+	if(devInfo.worker == nullptr || devInfo.worker->IsRunning() == false) {
+		auto args = m_workerArgs;
+		args.push_back("-worker");
+		args.push_back(std::string {"-device_type="} + ((devInfo.deviceType == unirender::Scene::DeviceType::CPU) ? "cpu" : "gpu"));
+		std::string err;
+		devInfo.worker = WorkerProcess::Spawn("/proc/self/exe", args, err);
+		if(devInfo.worker == nullptr) {
+			g_logger->error("Unable to start worker process for job '{}': {}", jobName, err);
+			++m_numFailed;
+			return false;
+		}
+		g_logger->info("Started worker process {} for device {}.", devInfo.worker->GetPid(), magic_enum::enum_name(devInfo.deviceType));
+	}
+	// The worker doesn't know about the sample counts determined by other workers
+	if(m_noiseTarget.has_value()) {
+		auto it = m_shotSampleCounts.find(get_shot_identifier(jobName));
+		if(it != m_shotSampleCounts.end())
+			devInfo.worker->SendLine("shot_samples\t" + it->first + "\t" + std::to_string(it->second));
+	}
+	// If the worker has died in the meantime, this will be detected by the next update
+	auto cmd = "job\t" + jobName;
+	if(job.draft)
+		cmd += "\tdraft";
+	devInfo.worker->SendLine(cmd);
+	g_logger->info("Sent job '{}' to worker process {}.", jobName, devInfo.worker->GetPid());
+	devInfo.workerJob = jobName;
+	devInfo.jobName = jobName;
+	devInfo.draft = job.draft;
+	devInfo.workerProgress = 0.f;
+	devInfo.workerRendering = false;
+	devInfo.workerNumSaved = 0;
+	devInfo.outputPath = util::Path::CreateFile(jobName);
+	devInfo.startTime = std::chrono::high_resolution_clock::now();
+	return true;
+}
+
+void RTJobManager::UpdateWorker(DeviceInfo &devInfo)
+{
+	if(devInfo.workerJob.has_value() == false)
+		return;
+	auto &worker = *devInfo.worker;
+	if(util::CommandManager::ShouldExit()) {
+		g_logger->info("Job has been cancelled!");
+		worker.Kill();
+		devInfo.worker = nullptr;
+		devInfo.workerJob = {};
+		return;
+	}
+	std::optional<float> progress {};
+	for(auto &line : worker.ReadLines()) {
+		std::vector<std::string> args;
+		ustring::explode(line, "\t", args);
+		if(args.empty())
+			continue;
+		auto &cmd = args.front();
+		if(cmd == "progress" && args.size() >= 3) {
+			progress = util::to_float(args[1]);
+			devInfo.outputPath = util::Path::CreateFile(args[2]);
+		}
+		else if(cmd == "rendering") {
+			devInfo.workerRendering = true;
+			devInfo.workerProgressTime = std::chrono::steady_clock::now();
+		}
+		else if(cmd == "metrics" && args.size() >= 2 && m_metrics)
+			m_metrics->WriteLine(args[1]);
+		else if(cmd == "result")
+			HandleWorkerResult(devInfo, args);
+		else if(cmd == "finished" && args.size() >= 3) {
+			m_numSkipped += util::to_uint(args[1]);
+			m_numFailed += util::to_uint(args[2]);
+			m_jobRetries.erase(*devInfo.workerJob);
+			devInfo.workerJob = {};
+			return;
+		}
+	}
+
+	auto t = std::chrono::steady_clock::now();
+	if(progress.has_value()) {
+		if(*progress != devInfo.workerProgress) {
+			devInfo.workerProgress = *progress;
+			devInfo.workerProgressTime = t;
+		}
+		LogProgress(devInfo, *progress);
+	}
+	if(worker.IsRunning() == false)
+		RetryWorkerJob(devInfo, "Worker process has terminated unexpectedly");
+	else if(devInfo.workerRendering && t - devInfo.workerProgressTime > m_workerTimeout)
+		RetryWorkerJob(devInfo, "Worker process hasn't made any progress for " + std::to_string(m_workerTimeout.count()) + " seconds");
+}
+
+void RTJobManager::HandleWorkerResult(DeviceInfo &devInfo, const std::vector<std::string> &args)
+{
+	devInfo.workerProgressTime = std::chrono::steady_clock::now();
+	devInfo.startTime = std::chrono::high_resolution_clock::now();
+	auto segment = (args.size() >= 2) ? SharedMemorySegment::Open(args[1]) : nullptr;
+	if(segment == nullptr) {
+		g_logger->error("Unable to open shared memory segment of result for job '{}'!", *devInfo.workerJob);
+		++m_numFailed;
+		return;
+	}
+	uimg::ImageLayerSet layers {};
+	OutputInfo output {};
+	for(size_t i = 2; i < args.size(); ++i) {
+		auto &arg = args[i];
+		auto sep = arg.find('=');
+		if(sep == std::string::npos)
+			continue;
+		auto key = arg.substr(0, sep);
+		auto val = arg.substr(sep + 1);
+		if(key == "output")
+			output.outputPath = util::Path::CreateFile(val);
+		else if(key == "job")
+			output.jobName = val;
+		else if(key == "render_mode")
+			output.renderMode = static_cast<unirender::Scene::RenderMode>(util::to_int(val));
+		else if(key == "apply_color_transform")
+			output.applyColorTransform = util::to_boolean(val);
+		else if(key == "draft")
+			output.draft = util::to_boolean(val);
+		else if(key == "shot")
+			output.shotId = val;
+		else if(key == "samples")
+			output.samples = util::to_uint(val);
+		else if(key == "max_samples")
+			output.maxSamples = util::to_uint(val);
+		else if(key == "color_transform") {
+			output.colorTransform = unirender::Scene::ColorTransformInfo {};
+			output.colorTransform->config = val;
+		}
+		else if(key == "look" && output.colorTransform.has_value())
+			output.colorTransform->lookName = val;
+		else if(key == "image") {
+			// <name>,<width>,<height>,<format>,<offset>,<size>
+			std::vector<std::string> imgArgs;
+			ustring::explode(val, ",", imgArgs);
+			if(imgArgs.size() != 6)
+				continue;
+			auto offset = std::strtoull(imgArgs[4].c_str(), nullptr, 10);
+			auto size = std::strtoull(imgArgs[5].c_str(), nullptr, 10);
+			auto format = static_cast<uimg::Format>(util::to_uint(imgArgs[3]));
+			auto imgBuf = uimg::ImageBuffer::Create(static_cast<uint8_t *>(segment->GetData()) + offset, util::to_uint(imgArgs[1]), util::to_uint(imgArgs[2]), format, true);
+			if(offset + size > segment->GetSize() || imgBuf->GetSize() != size) {
+				g_logger->error("Invalid image '{}' in result for job '{}'!", imgArgs[0], *devInfo.workerJob);
+				continue;
+			}
+			// The image refers to the shared memory directly instead of a copy, so the segment has to outlive it
+			layers.images[imgArgs[0]] = std::shared_ptr<uimg::ImageBuffer> {imgBuf.get(), [imgBuf, segment](uimg::ImageBuffer *) {}};
+		}
+	}
+	if(layers.images.empty()) {
+		g_logger->error("Result for job '{}' doesn't contain any images!", *devInfo.workerJob);
+		++m_numFailed;
+		return;
+	}
+	devInfo.outputPath = output.outputPath;
+	if(m_noiseTarget.has_value())
+		UpdateNoiseTarget(output, layers);
+	auto numSucceeded = m_numSucceeded;
+	SaveResult(output, std::move(layers));
+	devInfo.workerNumSaved += m_numSucceeded - numSucceeded;
+}
+
+void RTJobManager::RetryWorkerJob(DeviceInfo &devInfo, const std::string &reason)
+{
+	auto jobName = *devInfo.workerJob;
+	devInfo.workerJob = {};
+	auto pid = devInfo.worker ? devInfo.worker->GetPid() : -1;
+	devInfo.worker = nullptr; // A new worker will be started for the next job
+	++m_numWorkerRestarts;
+	if(pid != -1) {
+		// Segments are only unlinked once the supervisor opens them, results of the dead worker would leak otherwise
+		auto numRemoved = SharedMemorySegment::RemoveAll(pid);
+		if(numRemoved > 0)
+			g_logger->info("Removed {} stale shared memory segments of worker process {}.", numRemoved, pid);
+	}
+
+	auto &numRetries = m_jobRetries[jobName];
+	auto retry = (numRetries < m_maxWorkerRetries);
+	g_logger->error("{} while executing job '{}'! {}", reason, ufile::get_file_from_filename(jobName), retry ? "Retrying..." : "Giving up.");
+	if(m_metrics) {
+		RTMetrics::Record record {"worker_failure"};
+		record.Add("job", jobName).Add("device", std::string {magic_enum::enum_name(devInfo.deviceType)}).Add("reason", reason);
+		record.Add("attempt", numRetries + 1).Add("retry", retry).Add("total_restarts", m_numWorkerRestarts);
+		m_metrics->Write(record);
+	}
+	if(retry == false) {
+		m_jobRetries.erase(jobName);
+		// Views that have already been saved by the worker still count as succeeded
+		auto numViews = static_cast<uint32_t>(umath::max<size_t>(m_views.size(), 1));
+		m_numFailed += numViews - umath::min(devInfo.workerNumSaved, numViews);
+		return;
+	}
+	++numRetries;
+	// Views which have already been saved will be counted as skipped when the job is retried
+	m_numSucceeded -= devInfo.workerNumSaved;
+	m_jobQueue.push_front({jobName, devInfo.draft});
 }
 
 #ifdef __linux__
@@ -936,11 +2877,14 @@ DLLEXPORT int render_raytracing(int argc, char *argv[])
 	auto rtManager = RTJobManager::Launch(argc, argv);
 	if(rtManager == nullptr)
 		return EXIT_FAILURE;
+	if(rtManager->IsWorker())
+		return rtManager->RunWorker();
 	while(rtManager->IsComplete() == false)
 		rtManager->Update();
 
 	util::flash_window();
 	g_logger->info("{} succeeded, {} skipped and {} failed!", rtManager->GetNumSucceeded(), rtManager->GetNumSkipped(), rtManager->GetNumFailed());
+	auto replayPassed = rtManager->IsReplay() ? rtManager->FinishReplay() : true;
 
 	auto shutDown = rtManager->ShouldShutDownOnCompletion();
 	auto waitBeforeExit = true;
@@ -958,7 +2902,7 @@ DLLEXPORT int render_raytracing(int argc, char *argv[])
 		std::this_thread::sleep_for(std::chrono::seconds {5});
 		util::shutdown_os();
 	}
-	return EXIT_SUCCESS;
+	return replayPassed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 };
 #pragma optimize("", on)
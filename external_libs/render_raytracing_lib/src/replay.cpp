@@ -0,0 +1,134 @@
+#include "replay.hpp"
+#include <sharedutils/util.h>
+#include <sharedutils/util_file.h>
+#undef __UTIL_STRING_H__
+#include <sharedutils/util_string.h>
+#include <fstream>
+#include <cmath>
+#include <limits>
+
+static std::string resolve_path(const std::string &basePath, const std::string &path)
+{
+	if(path.empty() || path.front() == '/' || path.front() == '\\' || (path.length() > 1 && path[1] == ':'))
+		return path;
+	return basePath + path;
+}
+
+bool load_replay_manifest(const std::string &fileName, ReplayManifest &outManifest, std::string &outErr)
+{
+	std::ifstream f {fileName};
+	if(!f) {
+		outErr = "Unable to open file!";
+		return false;
+	}
+	auto basePath = ufile::get_path_from_filename(fileName);
+	outManifest.outputDir = resolve_path(basePath, outManifest.outputDir);
+	outManifest.reportFileName = resolve_path(basePath, outManifest.reportFileName);
+	std::string line;
+	uint32_t lineIdx = 0;
+	while(std::getline(f, line)) {
+		++lineIdx;
+		ustring::remove_whitespace(line);
+		if(line.empty() || line.front() == '#')
+			continue;
+		std::vector<std::string> args;
+		ustring::explode_whitespace(line, args);
+		auto sep = args.front().find('=');
+		if(sep != std::string::npos) {
+			if(args.size() > 1) {
+				outErr = "Unexpected arguments after setting in line " + std::to_string(lineIdx) + "!";
+				return false;
+			}
+			auto key = args.front().substr(0, sep);
+			auto val = args.front().substr(sep + 1);
+			if(key == "samples")
+				outManifest.samples = util::to_uint(val);
+			else if(key == "width")
+				outManifest.width = util::to_uint(val);
+			else if(key == "height")
+				outManifest.height = util::to_uint(val);
+			else if(key == "output_dir")
+				outManifest.outputDir = resolve_path(basePath, val);
+			else if(key == "report")
+				outManifest.reportFileName = resolve_path(basePath, val);
+			else if(key == "min_psnr")
+				outManifest.minPsnr = util::to_float(val);
+			else if(key == "max_slowdown")
+				outManifest.maxSlowdown = util::to_float(val);
+			else if(key == "max_peak_rss")
+				outManifest.maxPeakRss = static_cast<uint64_t>(util::to_uint(val)) * 1024 * 1024;
+			else {
+				outErr = "Unknown setting '" + key + "' in line " + std::to_string(lineIdx) + "!";
+				return false;
+			}
+			continue;
+		}
+
+		ReplayJob job {};
+		job.fileName = resolve_path(basePath, args.front());
+		for(auto it = args.begin() + 1; it != args.end(); ++it) {
+			auto &arg = *it;
+			sep = arg.find('=');
+			auto key = arg.substr(0, sep);
+			auto val = (sep != std::string::npos) ? arg.substr(sep + 1) : std::string {};
+			if(key == "reference" && val.empty() == false)
+				job.reference = resolve_path(basePath, val);
+			else if(key == "baseline_ms" && val.empty() == false)
+				job.baselineMs = util::to_float(val);
+			else {
+				outErr = "Invalid job argument '" + arg + "' in line " + std::to_string(lineIdx) + "!";
+				return false;
+			}
+		}
+		outManifest.jobs.push_back(std::move(job));
+	}
+	if(outManifest.samples == 0 || outManifest.width == 0 || outManifest.height == 0) {
+		outErr = "Samples and resolution have to be larger than 0!";
+		return false;
+	}
+	if(outManifest.jobs.empty()) {
+		outErr = "Manifest doesn't contain any jobs!";
+		return false;
+	}
+	if(outManifest.outputDir.empty() == false && outManifest.outputDir.back() != '/' && outManifest.outputDir.back() != '\\')
+		outManifest.outputDir += '/';
+	return true;
+}
+
+static uint64_t hash_image_data(const void *data, size_t size)
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	auto *bytes = static_cast<const uint8_t *>(data);
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+uint64_t get_image_checksum(const uimg::ImageBuffer &imgBuf)
+{
+	auto ldrBuf = imgBuf.Copy(uimg::Format::RGB_LDR);
+	return hash_image_data(ldrBuf->GetData(), static_cast<size_t>(ldrBuf->GetWidth()) * ldrBuf->GetHeight() * 3);
+}
+
+std::optional<double> get_image_psnr(const uimg::ImageBuffer &imgBuf, const uimg::ImageBuffer &reference)
+{
+	if(imgBuf.GetWidth() != reference.GetWidth() || imgBuf.GetHeight() != reference.GetHeight())
+		return {};
+	auto a = imgBuf.Copy(uimg::Format::RGB_LDR);
+	auto b = reference.Copy(uimg::Format::RGB_LDR);
+	auto *dataA = static_cast<const uint8_t *>(a->GetData());
+	auto *dataB = static_cast<const uint8_t *>(b->GetData());
+	auto numValues = static_cast<size_t>(a->GetWidth()) * a->GetHeight() * 3;
+	double sum = 0.0;
+	for(size_t i = 0; i < numValues; ++i) {
+		auto d = static_cast<double>(dataA[i]) - static_cast<double>(dataB[i]);
+		sum += d * d;
+	}
+	if(sum == 0.0)
+		return std::numeric_limits<double>::infinity();
+	auto mse = sum / static_cast<double>(numValues);
+	return 10.0 * std::log10((255.0 * 255.0) / mse);
+}
@@ -0,0 +1,44 @@
+#ifndef __RT_REPLAY_HPP__
+#define __RT_REPLAY_HPP__
+
+#include <util_image_buffer.hpp>
+#include <string>
+#include <vector>
+#include <optional>
+#include <cinttypes>
+
+// A fixed set of recorded jobs, which is rendered with pinned settings on the CPU to catch performance and quality
+// regressions, see -replay. Relative paths in the manifest are relative to the manifest itself.
+struct ReplayJob {
+	std::string fileName {};
+	std::string reference {}; // Image the result is compared against, optional
+	// Duration from the start of the job until the image has been saved in a previous run, optional
+	std::optional<double> baselineMs {};
+};
+struct ReplayManifest {
+	uint32_t samples = 16;
+	uint32_t width = 640;
+	uint32_t height = 360;
+	std::string outputDir = "replay/";
+	std::string reportFileName = "replay_report.json";
+
+	// A frame fails if its PSNR against the reference is lower than minPsnr, or if it took more than maxSlowdown times its baseline
+	double minPsnr = 40.0;
+	double maxSlowdown = 1.2;
+	// The replay fails if the peak resident memory exceeds this value (in bytes), 0 = unlimited
+	uint64_t maxPeakRss = 0;
+
+	std::vector<ReplayJob> jobs {};
+};
+
+// Each line is either a setting ("samples=<n>", "width=<w>", "height=<h>", "output_dir=<path>", "report=<file>", "min_psnr=<dB>",
+// "max_slowdown=<ratio>", "max_peak_rss=<MiB>") or a job ("<jobFile> [reference=<image>] [baseline_ms=<ms>]"). Lines starting with '#' are ignored.
+bool load_replay_manifest(const std::string &fileName, ReplayManifest &outManifest, std::string &outErr);
+
+// Checksum of the 8-bit RGB pixel data, i.e. of what is written to the PNG output
+uint64_t get_image_checksum(const uimg::ImageBuffer &imgBuf);
+
+// Peak signal-to-noise ratio of the 8-bit RGB channels in dB. Infinite if both images are identical, empty if the resolutions differ.
+std::optional<double> get_image_psnr(const uimg::ImageBuffer &imgBuf, const uimg::ImageBuffer &reference);
+
+#endif
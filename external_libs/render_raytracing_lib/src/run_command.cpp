@@ -0,0 +1,76 @@
+#include "run_command.hpp"
+#ifdef _WIN32
+#include <Windows.h>
+#include <vector>
+#else
+#include <cstdlib>
+#include <sys/wait.h>
+#endif
+
+#ifdef _WIN32
+// Quotes the argument according to the rules of CommandLineToArgvW, which is what most programs parse their command line with:
+// Backslashes are only special in front of double quotes.
+static std::string quote_argument(const std::string &arg)
+{
+	std::string quoted = "\"";
+	size_t numBackslashes = 0;
+	for(auto c : arg) {
+		if(c == '\\') {
+			++numBackslashes;
+			continue;
+		}
+		quoted.append((c == '\"') ? (numBackslashes * 2 + 1) : numBackslashes, '\\');
+		numBackslashes = 0;
+		quoted += c;
+	}
+	quoted.append(numBackslashes * 2, '\\');
+	return quoted + "\"";
+}
+
+static std::wstring to_wide_string(const std::string &str)
+{
+	auto len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()), nullptr, 0);
+	std::wstring wstr(len, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, str.c_str(), static_cast<int>(str.length()), wstr.data(), len);
+	return wstr;
+}
+
+int run_command(const std::string &command, const std::string &arg)
+{
+	auto cmdLine = to_wide_string(command + " " + quote_argument(arg));
+	std::vector<wchar_t> cmdLineBuf {cmdLine.begin(), cmdLine.end()};
+	cmdLineBuf.push_back(L'\0'); // CreateProcessW may modify the command line
+	STARTUPINFOW startupInfo {};
+	startupInfo.cb = sizeof(startupInfo);
+	PROCESS_INFORMATION processInfo {};
+	if(CreateProcessW(nullptr, cmdLineBuf.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo) == FALSE)
+		return -1;
+	WaitForSingleObject(processInfo.hProcess, INFINITE);
+	DWORD exitCode = 0;
+	auto success = GetExitCodeProcess(processInfo.hProcess, &exitCode);
+	CloseHandle(processInfo.hThread);
+	CloseHandle(processInfo.hProcess);
+	return success ? static_cast<int>(exitCode) : -1;
+}
+#else
+// Single quotes prevent any interpretation by the shell, only single quotes themselves have to be escaped
+static std::string quote_argument(const std::string &arg)
+{
+	std::string quoted = "'";
+	for(auto c : arg) {
+		if(c == '\'')
+			quoted += "'\\''";
+		else
+			quoted += c;
+	}
+	return quoted + "'";
+}
+
+int run_command(const std::string &command, const std::string &arg)
+{
+	auto status = std::system((command + " " + quote_argument(arg)).c_str());
+	if(status == -1 || WIFEXITED(status) == false)
+		return -1;
+	return WEXITSTATUS(status);
+}
+#endif
@@ -0,0 +1,12 @@
+#ifndef __RT_RUN_COMMAND_HPP__
+#define __RT_RUN_COMMAND_HPP__
+
+#include <string>
+
+// Runs 'command' with 'arg' appended as a single argument, which is quoted so it reaches the program unchanged regardless of
+// the characters it contains. Blocks until the command has finished and returns its exit code, or -1 if it couldn't be started.
+// On Windows the command is started with CreateProcess instead of through cmd.exe, since cmd.exe would still expand '%' and '^'
+// in quoted arguments.
+int run_command(const std::string &command, const std::string &arg);
+
+#endif
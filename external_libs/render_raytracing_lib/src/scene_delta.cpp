@@ -0,0 +1,378 @@
+#include "scene_delta.hpp"
+#include <util_raytracing/scene.hpp>
+#include <util_raytracing/object.hpp>
+#include <util_raytracing/light.hpp>
+#include <util_raytracing/camera.hpp>
+#include <sharedutils/util.h>
+#include <sharedutils/util_file.h>
+#undef __UTIL_STRING_H__
+#include <sharedutils/util_string.h>
+#include <fsys/filesystem.h>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cctype>
+
+bool is_scene_delta_file(const std::string &fileName)
+{
+	std::string ext;
+	return ufile::get_extension(fileName, &ext) && ustring::compare<std::string>(ext, "rtdelta", false);
+}
+
+static std::optional<std::vector<float>> parse_floats(const std::string &str, size_t count)
+{
+	std::vector<std::string> components;
+	ustring::explode(str, ",", components);
+	if(components.size() != count)
+		return {};
+	std::vector<float> values;
+	values.reserve(count);
+	for(auto &c : components)
+		values.push_back(util::to_float(c));
+	return values;
+}
+
+static bool parse_transform_arg(const std::string &key, const std::string &val, SceneDelta::TransformDelta &delta)
+{
+	if(key == "pos" || key == "scale") {
+		auto v = parse_floats(val, 3);
+		if(v.has_value() == false)
+			return false;
+		(key == "pos" ? delta.pos : delta.scale) = Vector3 {(*v)[0], (*v)[1], (*v)[2]};
+		return true;
+	}
+	if(key == "rot") {
+		auto v = parse_floats(val, 4);
+		if(v.has_value() == false)
+			return false;
+		delta.rot = Quat {(*v)[0], (*v)[1], (*v)[2], (*v)[3]};
+		return true;
+	}
+	if(key == "ang") {
+		auto v = parse_floats(val, 3);
+		if(v.has_value() == false)
+			return false;
+		delta.rot = uquat::create(EulerAngles {(*v)[0], (*v)[1], (*v)[2]});
+		return true;
+	}
+	return false;
+}
+
+bool load_scene_delta(const std::string &fileName, SceneDelta &outDelta, std::string &outErr)
+{
+	auto f = FileManager::OpenSystemFile(fileName.c_str(), "r");
+	if(f == nullptr) {
+		outErr = "Unable to open file!";
+		return false;
+	}
+	std::vector<std::string> lines;
+	ustring::explode(f->ReadString(), "\n", lines);
+	uint32_t lineIdx = 0;
+	for(auto &line : lines) {
+		++lineIdx;
+		ustring::remove_whitespace(line);
+		if(line.empty() || line.front() == '#')
+			continue;
+		std::vector<std::string> args;
+		ustring::explode_whitespace(line, args);
+		auto &type = args.front();
+		auto invalidLine = [&outErr, lineIdx](const std::string &msg) {
+			outErr = "Line " + std::to_string(lineIdx) + ": " + msg;
+			return false;
+		};
+		if(ustring::compare<std::string>(type.substr(0, 5), "base=", true)) {
+			outDelta.baseFileName = type.substr(5);
+			continue;
+		}
+
+		SceneDelta::TransformDelta *transformDelta = nullptr;
+		SceneDelta::LightDelta *lightDelta = nullptr;
+		SceneDelta::CameraDelta *cameraDelta = nullptr;
+		size_t argOffset = 1;
+		if(type == "camera") {
+			outDelta.camera = SceneDelta::CameraDelta {};
+			transformDelta = cameraDelta = &*outDelta.camera;
+		}
+		else if(type == "object" || type == "light") {
+			if(args.size() < 2)
+				return invalidLine("Missing name for " + type + "!");
+			argOffset = 2;
+			if(type == "object") {
+				outDelta.objects.push_back({});
+				outDelta.objects.back().name = args[1];
+				transformDelta = &outDelta.objects.back();
+			}
+			else {
+				outDelta.lights.push_back({});
+				outDelta.lights.back().name = args[1];
+				transformDelta = lightDelta = &outDelta.lights.back();
+			}
+		}
+		else
+			return invalidLine("Unsupported record type '" + type + "'!");
+
+		for(auto i = argOffset; i < args.size(); ++i) {
+			auto &arg = args[i];
+			auto sep = arg.find('=');
+			if(sep == std::string::npos)
+				return invalidLine("Invalid argument '" + arg + "'!");
+			auto key = arg.substr(0, sep);
+			auto val = arg.substr(sep + 1);
+			if(parse_transform_arg(key, val, *transformDelta))
+				continue;
+			if(cameraDelta && key == "fov") {
+				cameraDelta->fov = util::to_float(val);
+				continue;
+			}
+			if(lightDelta && key == "color") {
+				auto v = parse_floats(val, 3);
+				if(v.has_value()) {
+					lightDelta->color = Vector3 {(*v)[0], (*v)[1], (*v)[2]};
+					continue;
+				}
+			}
+			else if(lightDelta && key == "intensity") {
+				lightDelta->intensity = util::to_float(val);
+				continue;
+			}
+			return invalidLine("Invalid argument '" + arg + "'!");
+		}
+	}
+	if(outDelta.baseFileName.empty()) {
+		outErr = "No base scene specified!";
+		return false;
+	}
+	return true;
+}
+
+static void apply_transform(unirender::WorldObject &o, const SceneDelta::TransformDelta &delta, std::vector<std::function<void()>> &outRestoreState)
+{
+	if(delta.pos.has_value()) {
+		outRestoreState.push_back([&o, pos = o.GetPos()]() { o.SetPos(pos); });
+		o.SetPos(*delta.pos);
+	}
+	if(delta.rot.has_value()) {
+		outRestoreState.push_back([&o, rot = o.GetRotation()]() { o.SetRotation(rot); });
+		o.SetRotation(*delta.rot);
+	}
+	if(delta.scale.has_value()) {
+		outRestoreState.push_back([&o, scale = o.GetScale()]() { o.SetScale(scale); });
+		o.SetScale(*delta.scale);
+	}
+}
+
+std::vector<std::string> apply_scene_delta(unirender::Scene &scene, const SceneDelta &delta, std::vector<std::function<void()>> &outRestoreState)
+{
+	std::vector<std::string> missing;
+	if(delta.camera.has_value()) {
+		auto &cam = scene.GetCamera();
+		apply_transform(cam, *delta.camera, outRestoreState);
+		if(delta.camera->fov.has_value()) {
+			outRestoreState.push_back([&cam, fov = cam.GetFov()]() { cam.SetFOV(fov); });
+			cam.SetFOV(*delta.camera->fov);
+		}
+	}
+
+	if(delta.objects.empty() == false) {
+		std::unordered_map<std::string, unirender::Object *> objects;
+		for(auto &o : scene.GetObjects())
+			objects[o->GetName()] = o.get();
+		for(auto &objDelta : delta.objects) {
+			auto it = objects.find(objDelta.name);
+			if(it == objects.end()) {
+				missing.push_back(objDelta.name);
+				continue;
+			}
+			apply_transform(*it->second, objDelta, outRestoreState);
+		}
+	}
+
+	if(delta.lights.empty() == false) {
+		std::unordered_map<std::string, unirender::Light *> lights;
+		for(auto &l : scene.GetLights())
+			lights[l->GetName()] = l.get();
+		for(auto &lightDelta : delta.lights) {
+			auto it = lights.find(lightDelta.name);
+			if(it == lights.end()) {
+				missing.push_back(lightDelta.name);
+				continue;
+			}
+			auto &light = *it->second;
+			apply_transform(light, lightDelta, outRestoreState);
+			if(lightDelta.color.has_value()) {
+				outRestoreState.push_back([&light, color = light.GetColor()]() { light.SetColor(color); });
+				light.SetColor(*lightDelta.color);
+			}
+			if(lightDelta.intensity.has_value()) {
+				outRestoreState.push_back([&light, intensity = light.GetIntensity()]() { light.SetIntensity(intensity); });
+				light.SetIntensity(*lightDelta.intensity);
+			}
+		}
+	}
+	return missing;
+}
+
+static std::string join_components(std::initializer_list<float> components)
+{
+	std::stringstream ss;
+	ss.precision(std::numeric_limits<float>::max_digits10);
+	auto first = true;
+	for(auto c : components) {
+		if(first == false)
+			ss << ",";
+		ss << c;
+		first = false;
+	}
+	return ss.str();
+}
+static std::string to_string(const Vector3 &v) { return join_components({v.x, v.y, v.z}); }
+static std::string to_string(const Quat &rot) { return join_components({rot.w, rot.x, rot.y, rot.z}); }
+static std::string to_string(float f) { return join_components({f}); }
+
+static void write_transform(std::ostream &out, const SceneDelta::TransformDelta &delta)
+{
+	if(delta.pos.has_value())
+		out << " pos=" << to_string(*delta.pos);
+	if(delta.rot.has_value())
+		out << " rot=" << to_string(*delta.rot);
+	if(delta.scale.has_value())
+		out << " scale=" << to_string(*delta.scale);
+}
+
+bool save_scene_delta(const std::string &fileName, const SceneDelta &delta, std::string &outErr)
+{
+	std::ofstream f {fileName, std::ios::trunc};
+	if(f.is_open() == false) {
+		outErr = "Unable to open file!";
+		return false;
+	}
+	f << "base=" << delta.baseFileName << "\n";
+	if(delta.camera.has_value()) {
+		f << "camera";
+		write_transform(f, *delta.camera);
+		if(delta.camera->fov.has_value())
+			f << " fov=" << to_string(*delta.camera->fov);
+		f << "\n";
+	}
+	for(auto &objDelta : delta.objects) {
+		f << "object " << objDelta.name;
+		write_transform(f, objDelta);
+		f << "\n";
+	}
+	for(auto &lightDelta : delta.lights) {
+		f << "light " << lightDelta.name;
+		write_transform(f, lightDelta);
+		if(lightDelta.color.has_value())
+			f << " color=" << to_string(*lightDelta.color);
+		if(lightDelta.intensity.has_value())
+			f << " intensity=" << to_string(*lightDelta.intensity);
+		f << "\n";
+	}
+	if(f.good() == false) {
+		outErr = "Unable to write file!";
+		return false;
+	}
+	return true;
+}
+
+static bool is_valid_record_name(const std::string &name)
+{
+	return name.empty() == false && std::find_if(name.begin(), name.end(), [](char c) { return std::isspace(static_cast<unsigned char>(c)); }) == name.end();
+}
+
+static void make_transform_delta(const unirender::WorldObject &base, const unirender::WorldObject &frame, SceneDelta::TransformDelta &outDelta)
+{
+	if(frame.GetPos() != base.GetPos())
+		outDelta.pos = frame.GetPos();
+	if(frame.GetRotation() != base.GetRotation())
+		outDelta.rot = frame.GetRotation();
+	if(frame.GetScale() != base.GetScale())
+		outDelta.scale = frame.GetScale();
+}
+
+static bool is_transform_delta_empty(const SceneDelta::TransformDelta &delta) { return delta.pos.has_value() == false && delta.rot.has_value() == false && delta.scale.has_value() == false; }
+
+// Maps the names of the objects or lights of a scene to the objects, fails if a name isn't unique or can't be written to a delta file
+template<class T, class TContainer>
+static bool map_by_name(const TContainer &container, std::unordered_map<std::string, T *> &outMap, std::string &outErr)
+{
+	for(auto &o : container) {
+		auto name = o->GetName();
+		if(is_valid_record_name(name) == false) {
+			outErr = "Name '" + name + "' can't be used in a scene delta!";
+			return false;
+		}
+		if(outMap.insert(std::make_pair(name, o.get())).second == false) {
+			outErr = "Name '" + name + "' isn't unique!";
+			return false;
+		}
+	}
+	return true;
+}
+
+bool make_scene_delta(unirender::Scene &base, unirender::Scene &frame, SceneDelta &outDelta, std::string &outErr)
+{
+	auto &baseCam = base.GetCamera();
+	auto &frameCam = frame.GetCamera();
+	SceneDelta::CameraDelta cameraDelta {};
+	make_transform_delta(baseCam, frameCam, cameraDelta);
+	if(frameCam.GetFov() != baseCam.GetFov())
+		cameraDelta.fov = frameCam.GetFov();
+	if(is_transform_delta_empty(cameraDelta) == false || cameraDelta.fov.has_value())
+		outDelta.camera = cameraDelta;
+
+	std::unordered_map<std::string, unirender::Object *> baseObjects;
+	std::unordered_map<std::string, unirender::Object *> frameObjects;
+	if(map_by_name(base.GetObjects(), baseObjects, outErr) == false || map_by_name(frame.GetObjects(), frameObjects, outErr) == false)
+		return false;
+	if(baseObjects.size() != frameObjects.size()) {
+		outErr = "Scenes don't have the same number of objects!";
+		return false;
+	}
+	for(auto &[name, o] : frameObjects) {
+		auto it = baseObjects.find(name);
+		if(it == baseObjects.end()) {
+			outErr = "Object '" + name + "' doesn't exist in base scene!";
+			return false;
+		}
+		SceneDelta::ObjectDelta objDelta {};
+		make_transform_delta(*it->second, *o, objDelta);
+		if(is_transform_delta_empty(objDelta))
+			continue;
+		objDelta.name = name;
+		outDelta.objects.push_back(std::move(objDelta));
+	}
+
+	std::unordered_map<std::string, unirender::Light *> baseLights;
+	std::unordered_map<std::string, unirender::Light *> frameLights;
+	if(map_by_name(base.GetLights(), baseLights, outErr) == false || map_by_name(frame.GetLights(), frameLights, outErr) == false)
+		return false;
+	if(baseLights.size() != frameLights.size()) {
+		outErr = "Scenes don't have the same number of lights!";
+		return false;
+	}
+	for(auto &[name, light] : frameLights) {
+		auto it = baseLights.find(name);
+		if(it == baseLights.end()) {
+			outErr = "Light '" + name + "' doesn't exist in base scene!";
+			return false;
+		}
+		auto &baseLight = *it->second;
+		SceneDelta::LightDelta lightDelta {};
+		make_transform_delta(baseLight, *light, lightDelta);
+		if(light->GetColor() != baseLight.GetColor())
+			lightDelta.color = light->GetColor();
+		if(light->GetIntensity() != baseLight.GetIntensity())
+			lightDelta.intensity = light->GetIntensity();
+		if(is_transform_delta_empty(lightDelta) && lightDelta.color.has_value() == false && lightDelta.intensity.has_value() == false)
+			continue;
+		lightDelta.name = name;
+		outDelta.lights.push_back(std::move(lightDelta));
+	}
+	// Sorted, so the same frame always results in the same file
+	std::sort(outDelta.objects.begin(), outDelta.objects.end(), [](const SceneDelta::ObjectDelta &a, const SceneDelta::ObjectDelta &b) { return a.name < b.name; });
+	std::sort(outDelta.lights.begin(), outDelta.lights.end(), [](const SceneDelta::LightDelta &a, const SceneDelta::LightDelta &b) { return a.name < b.name; });
+	return true;
+}
@@ -0,0 +1,57 @@
+#ifndef __RT_SCENE_DELTA_HPP__
+#define __RT_SCENE_DELTA_HPP__
+
+#include <mathutil/uvec.h>
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+
+namespace unirender {
+	class Scene;
+};
+
+// A scene delta describes the changes of a single animation frame relative to a shared base scene.
+// Delta files are text files with the extension ".rtdelta", with one record per line (see -make_deltas for creating them from existing jobs):
+// base=<baseJobFile>                           (relative to the delta file)
+// camera [pos=x,y,z] [rot=w,x,y,z | ang=p,y,r] [fov=<degrees>]
+// object <name> [pos=x,y,z] [rot=w,x,y,z | ang=p,y,r] [scale=x,y,z]
+// light <name> [pos=x,y,z] [rot=w,x,y,z | ang=p,y,r] [color=r,g,b] [intensity=<lumen>]
+struct SceneDelta {
+	struct TransformDelta {
+		std::optional<Vector3> pos {};
+		std::optional<Quat> rot {};
+		std::optional<Vector3> scale {};
+	};
+	struct CameraDelta : public TransformDelta {
+		std::optional<float> fov {};
+	};
+	struct ObjectDelta : public TransformDelta {
+		std::string name;
+	};
+	struct LightDelta : public TransformDelta {
+		std::string name;
+		std::optional<Vector3> color {};
+		std::optional<float> intensity {};
+	};
+	std::string baseFileName;
+	std::optional<CameraDelta> camera {};
+	std::vector<ObjectDelta> objects {};
+	std::vector<LightDelta> lights {};
+};
+
+bool is_scene_delta_file(const std::string &fileName);
+bool load_scene_delta(const std::string &fileName, SceneDelta &outDelta, std::string &outErr);
+bool save_scene_delta(const std::string &fileName, const SceneDelta &delta, std::string &outErr);
+
+// Determines the changes of the frame relative to the base scene. Only the camera, the transforms of objects and lights and the
+// color and intensity of lights are compared, everything else (meshes, shaders, render settings) has to be the same in both scenes.
+// Fails if the scenes don't consist of the same uniquely named objects and lights.
+bool make_scene_delta(unirender::Scene &base, unirender::Scene &frame, SceneDelta &outDelta, std::string &outErr);
+
+// Applies the delta to the scene. For every property that is changed, a function which restores the
+// previous value is appended to outRestoreState, so the next delta can be applied to the unmodified base scene.
+// Returns the names of objects and lights which couldn't be found in the scene.
+std::vector<std::string> apply_scene_delta(unirender::Scene &scene, const SceneDelta &delta, std::vector<std::function<void()>> &outRestoreState);
+
+#endif
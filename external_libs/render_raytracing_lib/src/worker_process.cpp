@@ -0,0 +1,300 @@
+#include "worker_process.hpp"
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#endif
+
+#ifdef __linux__
+bool is_worker_process_supported() { return true; }
+
+static bool write_all(int fd, const char *data, size_t size)
+{
+	while(size > 0) {
+		auto n = write(fd, data, size);
+		if(n < 0) {
+			if(errno == EINTR)
+				continue;
+			return false;
+		}
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void extract_lines(std::string &buffer, std::vector<std::string> &outLines)
+{
+	size_t start = 0;
+	for(auto pos = buffer.find('\n'); pos != std::string::npos; pos = buffer.find('\n', start)) {
+		outLines.push_back(buffer.substr(start, pos - start));
+		start = pos + 1;
+	}
+	buffer.erase(0, start);
+}
+
+std::unique_ptr<WorkerProcess> WorkerProcess::Spawn(const std::string &exePath, const std::vector<std::string> &args, std::string &outErr)
+{
+	// Writing to the pipe of a crashed worker must not terminate the supervisor
+	signal(SIGPIPE, SIG_IGN);
+
+	int commandPipe[2];
+	int resultPipe[2];
+	if(pipe2(commandPipe, O_CLOEXEC) != 0) {
+		outErr = std::string {"Unable to create pipe: "} + strerror(errno);
+		return nullptr;
+	}
+	if(pipe2(resultPipe, O_CLOEXEC) != 0) {
+		outErr = std::string {"Unable to create pipe: "} + strerror(errno);
+		close(commandPipe[0]);
+		close(commandPipe[1]);
+		return nullptr;
+	}
+
+	std::vector<std::string> argStrings;
+	argStrings.reserve(args.size() + 1);
+	argStrings.push_back(exePath);
+	argStrings.insert(argStrings.end(), args.begin(), args.end());
+	std::vector<char *> argv;
+	argv.reserve(argStrings.size() + 1);
+	for(auto &arg : argStrings)
+		argv.push_back(arg.data());
+	argv.push_back(nullptr);
+
+	auto pid = fork();
+	if(pid < 0) {
+		outErr = std::string {"Unable to fork process: "} + strerror(errno);
+		for(auto fd : {commandPipe[0], commandPipe[1], resultPipe[0], resultPipe[1]})
+			close(fd);
+		return nullptr;
+	}
+	if(pid == 0) {
+		// Child process; Move the pipes out of the way first, in case they already occupy the target descriptors.
+		// The temporary descriptors are closed on exec, only the ones duplicated by dup2 are inherited.
+		auto cmdFd = fcntl(commandPipe[0], F_DUPFD_CLOEXEC, 10);
+		auto resFd = fcntl(resultPipe[1], F_DUPFD_CLOEXEC, 10);
+		if(cmdFd < 0 || resFd < 0 || dup2(cmdFd, WorkerChannel::COMMAND_FD) < 0 || dup2(resFd, WorkerChannel::RESULT_FD) < 0)
+			_exit(EXIT_FAILURE);
+		execv(exePath.c_str(), argv.data());
+		_exit(EXIT_FAILURE);
+	}
+
+	close(commandPipe[0]);
+	close(resultPipe[1]);
+	fcntl(resultPipe[0], F_SETFL, fcntl(resultPipe[0], F_GETFL) | O_NONBLOCK);
+
+	auto process = std::unique_ptr<WorkerProcess> {new WorkerProcess {}};
+	process->m_pid = pid;
+	process->m_commandFd = commandPipe[1];
+	process->m_resultFd = resultPipe[0];
+	return process;
+}
+
+WorkerProcess::~WorkerProcess()
+{
+	Kill();
+	if(m_commandFd != -1)
+		close(m_commandFd);
+	if(m_resultFd != -1)
+		close(m_resultFd);
+}
+
+bool WorkerProcess::SendLine(const std::string &line)
+{
+	if(m_commandFd == -1)
+		return false;
+	auto msg = line + '\n';
+	return write_all(m_commandFd, msg.data(), msg.size());
+}
+
+std::vector<std::string> WorkerProcess::ReadLines()
+{
+	std::vector<std::string> lines;
+	char buf[4096];
+	for(;;) {
+		auto n = read(m_resultFd, buf, sizeof(buf));
+		if(n > 0) {
+			m_readBuffer.append(buf, n);
+			continue;
+		}
+		if(n < 0 && errno == EINTR)
+			continue;
+		break; // EAGAIN, EOF or error
+	}
+	extract_lines(m_readBuffer, lines);
+	return lines;
+}
+
+bool WorkerProcess::IsRunning()
+{
+	if(m_exited)
+		return false;
+	int status;
+	auto r = waitpid(m_pid, &status, WNOHANG);
+	if(r == m_pid || (r < 0 && errno == ECHILD))
+		m_exited = true;
+	return !m_exited;
+}
+
+void WorkerProcess::RequestQuit()
+{
+	if(m_pid == -1 || m_exited)
+		return;
+	SendLine("quit");
+	// The worker also exits if the pipe is closed, e.g. if it's still busy reading the previous command
+	close(m_commandFd);
+	m_commandFd = -1;
+}
+
+void WorkerProcess::WaitForExit(std::chrono::steady_clock::time_point deadline)
+{
+	while(IsRunning()) {
+		if(std::chrono::steady_clock::now() >= deadline) {
+			Kill();
+			return;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds {10});
+	}
+}
+
+void WorkerProcess::Kill()
+{
+	if(m_pid == -1 || m_exited)
+		return;
+	kill(m_pid, SIGKILL);
+	int status;
+	waitpid(m_pid, &status, 0);
+	m_exited = true;
+}
+
+bool WorkerChannel::ReadLine(std::string &outLine)
+{
+	for(;;) {
+		auto pos = m_readBuffer.find('\n');
+		if(pos != std::string::npos) {
+			outLine = m_readBuffer.substr(0, pos);
+			m_readBuffer.erase(0, pos + 1);
+			return true;
+		}
+		char buf[1024];
+		auto n = read(COMMAND_FD, buf, sizeof(buf));
+		if(n < 0 && errno == EINTR)
+			continue;
+		if(n <= 0)
+			return false;
+		m_readBuffer.append(buf, n);
+	}
+}
+
+bool WorkerChannel::SendLine(const std::string &line)
+{
+	std::scoped_lock lock {m_sendMutex};
+	auto msg = line + '\n';
+	return write_all(RESULT_FD, msg.data(), msg.size());
+}
+
+static std::string get_segment_prefix(int32_t pid) { return "render_raytracing_" + std::to_string(pid) + "_"; }
+
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::Create(size_t size, std::string &outName)
+{
+	static std::atomic<uint32_t> segmentIdx = 0;
+	auto name = "/" + get_segment_prefix(getpid()) + std::to_string(segmentIdx++);
+	auto fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	if(fd < 0)
+		return nullptr;
+	if(ftruncate(fd, size) != 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+		return nullptr;
+	}
+	auto *data = (size > 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : nullptr;
+	close(fd);
+	if(data == MAP_FAILED) {
+		shm_unlink(name.c_str());
+		return nullptr;
+	}
+	auto segment = std::shared_ptr<SharedMemorySegment> {new SharedMemorySegment {}};
+	segment->m_data = data;
+	segment->m_size = size;
+	outName = name;
+	return segment;
+}
+
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::Open(const std::string &name)
+{
+	auto fd = shm_open(name.c_str(), O_RDWR, 0);
+	if(fd < 0)
+		return nullptr;
+	shm_unlink(name.c_str());
+	struct stat st {};
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		return nullptr;
+	}
+	size_t size = st.st_size;
+	// Mapped privately, so the image can be modified in place without a copy of the whole segment
+	auto *data = (size > 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : nullptr;
+	close(fd);
+	if(data == MAP_FAILED)
+		return nullptr;
+	auto segment = std::shared_ptr<SharedMemorySegment> {new SharedMemorySegment {}};
+	segment->m_data = data;
+	segment->m_size = size;
+	return segment;
+}
+
+uint32_t SharedMemorySegment::RemoveAll(int32_t pid)
+{
+	// POSIX shared memory objects are listed in /dev/shm on Linux
+	auto *dir = opendir("/dev/shm");
+	if(dir == nullptr)
+		return 0;
+	auto prefix = get_segment_prefix(pid);
+	uint32_t numRemoved = 0;
+	while(auto *entry = readdir(dir)) {
+		if(strncmp(entry->d_name, prefix.c_str(), prefix.length()) != 0)
+			continue;
+		if(shm_unlink(("/" + std::string {entry->d_name}).c_str()) == 0)
+			++numRemoved;
+	}
+	closedir(dir);
+	return numRemoved;
+}
+
+SharedMemorySegment::~SharedMemorySegment()
+{
+	if(m_data != nullptr)
+		munmap(m_data, m_size);
+}
+#else
+bool is_worker_process_supported() { return false; }
+
+std::unique_ptr<WorkerProcess> WorkerProcess::Spawn(const std::string &exePath, const std::vector<std::string> &args, std::string &outErr)
+{
+	outErr = "Worker processes are not supported on this platform!";
+	return nullptr;
+}
+WorkerProcess::~WorkerProcess() {}
+bool WorkerProcess::SendLine(const std::string &line) { return false; }
+std::vector<std::string> WorkerProcess::ReadLines() { return {}; }
+bool WorkerProcess::IsRunning() { return false; }
+void WorkerProcess::RequestQuit() {}
+void WorkerProcess::WaitForExit(std::chrono::steady_clock::time_point deadline) {}
+void WorkerProcess::Kill() {}
+
+bool WorkerChannel::ReadLine(std::string &outLine) { return false; }
+bool WorkerChannel::SendLine(const std::string &line) { return false; }
+
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::Create(size_t size, std::string &outName) { return nullptr; }
+std::shared_ptr<SharedMemorySegment> SharedMemorySegment::Open(const std::string &name) { return nullptr; }
+uint32_t SharedMemorySegment::RemoveAll(int32_t pid) { return 0; }
+SharedMemorySegment::~SharedMemorySegment() {}
+#endif
@@ -0,0 +1,77 @@
+#ifndef __RT_WORKER_PROCESS_HPP__
+#define __RT_WORKER_PROCESS_HPP__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cinttypes>
+
+// Process isolation for render jobs. The supervisor spawns one worker process per device slot and communicates
+// with it through two pipes, which are mapped to fixed file descriptors in the worker (stdout/stderr are left alone,
+// so the worker can still log to the console). Rendered images are transferred through shared memory.
+// Only supported on Linux.
+bool is_worker_process_supported();
+
+class WorkerProcess {
+  public:
+	static std::unique_ptr<WorkerProcess> Spawn(const std::string &exePath, const std::vector<std::string> &args, std::string &outErr);
+	~WorkerProcess();
+	WorkerProcess(const WorkerProcess &) = delete;
+	WorkerProcess &operator=(const WorkerProcess &) = delete;
+
+	bool SendLine(const std::string &line);
+	// Non-blocking, returns all complete lines that have been received since the last call
+	std::vector<std::string> ReadLines();
+	bool IsRunning();
+	// Asks the worker to exit once it has finished its current command
+	void RequestQuit();
+	// Waits for the worker to exit and kills it if it's still running at the deadline
+	void WaitForExit(std::chrono::steady_clock::time_point deadline);
+	void Kill();
+	int32_t GetPid() const { return m_pid; }
+  private:
+	WorkerProcess() = default;
+	int32_t m_pid = -1;
+	int32_t m_commandFd = -1;
+	int32_t m_resultFd = -1;
+	bool m_exited = false;
+	std::string m_readBuffer;
+};
+
+// Worker side of the pipes
+class WorkerChannel {
+  public:
+	static constexpr int32_t COMMAND_FD = 3;
+	static constexpr int32_t RESULT_FD = 4;
+	// Blocks until a line has been received. Returns false if the supervisor has closed the pipe.
+	bool ReadLine(std::string &outLine);
+	bool SendLine(const std::string &line);
+  private:
+	std::mutex m_sendMutex;
+	std::string m_readBuffer;
+};
+
+class SharedMemorySegment {
+  public:
+	// Creates a new segment with a unique name, which stays alive after it has been unmapped, until it's opened by the other process
+	static std::shared_ptr<SharedMemorySegment> Create(size_t size, std::string &outName);
+	// Maps an existing segment and removes its name, so the memory is released once it has been unmapped
+	static std::shared_ptr<SharedMemorySegment> Open(const std::string &name);
+	// Removes all segments that were created by the specified process and haven't been opened yet, e.g. because the
+	// process has crashed or was killed before the supervisor received the result. Returns the number of removed segments.
+	static uint32_t RemoveAll(int32_t pid);
+	~SharedMemorySegment();
+	SharedMemorySegment(const SharedMemorySegment &) = delete;
+	SharedMemorySegment &operator=(const SharedMemorySegment &) = delete;
+
+	void *GetData() { return m_data; }
+	size_t GetSize() const { return m_size; }
+  private:
+	SharedMemorySegment() = default;
+	void *m_data = nullptr;
+	size_t m_size = 0;
+};
+
+#endif
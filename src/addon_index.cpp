@@ -0,0 +1,137 @@
+#include "addon_index.hpp"
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t ADDON_INDEX_VERSION = 3;
+
+struct AddonIndexEntry {
+	int64_t mtime = 0;
+	std::vector<std::string> directories {}; // Top-level directories of the addon
+};
+
+static int64_t get_modification_time(const fs::path &path)
+{
+	std::error_code ec;
+	auto t = fs::last_write_time(path, ec);
+	return ec ? -1 : static_cast<int64_t>(t.time_since_epoch().count());
+}
+
+// Index format: "<version>\t<addon directory mtime>" followed by one "<addon>\t<mtime>\t<directory>\t<directory>..." line per addon
+static bool load_index(const fs::path &indexFile, int64_t &outDirMtime, std::vector<std::pair<std::string, AddonIndexEntry>> &outEntries)
+{
+	std::ifstream f {indexFile};
+	if(!f)
+		return false;
+	uint32_t version = 0;
+	std::string line;
+	if(!std::getline(f, line) || !(std::istringstream {line} >> version >> outDirMtime) || version != ADDON_INDEX_VERSION)
+		return false;
+	while(std::getline(f, line)) {
+		auto sep0 = line.find('\t');
+		if(sep0 == std::string::npos)
+			return false;
+		AddonIndexEntry entry {};
+		entry.mtime = std::strtoll(line.c_str() + sep0 + 1, nullptr, 10);
+		for(auto sep = line.find('\t', sep0 + 1); sep != std::string::npos;) {
+			auto next = line.find('\t', sep + 1);
+			entry.directories.push_back(line.substr(sep + 1, (next != std::string::npos) ? (next - sep - 1) : std::string::npos));
+			sep = next;
+		}
+		outEntries.push_back({line.substr(0, sep0), std::move(entry)});
+	}
+	return true;
+}
+
+static void save_index(const fs::path &indexFile, int64_t dirMtime, const std::vector<std::pair<std::string, AddonIndexEntry>> &entries)
+{
+	std::error_code ec;
+	fs::create_directories(indexFile.parent_path(), ec);
+	auto tmpFile = indexFile;
+	tmpFile += ".tmp";
+	{
+		std::ofstream f {tmpFile, std::ios::trunc};
+		if(!f)
+			return;
+		f << ADDON_INDEX_VERSION << '\t' << dirMtime << '\n';
+		for(auto &[name, entry] : entries) {
+			f << name << '\t' << entry.mtime;
+			for(auto &dir : entry.directories)
+				f << '\t' << dir;
+			f << '\n';
+		}
+		if(!f)
+			return;
+	}
+	fs::rename(tmpFile, indexFile, ec);
+}
+
+static std::vector<std::string> get_top_level_directories(const fs::path &path)
+{
+	std::vector<std::string> directories;
+	std::error_code ec;
+	for(auto &entry : fs::directory_iterator {path, ec}) {
+		if(entry.is_directory(ec))
+			directories.push_back(entry.path().filename().string());
+	}
+	return directories;
+}
+
+std::vector<std::string> find_addons(const fs::path &addonDir, const fs::path &indexFile, const std::function<std::vector<std::string>()> &listAddons, const std::vector<std::string> &requiredDirectories, AddonIndexStats &outStats)
+{
+	outStats = {};
+	auto dirMtime = get_modification_time(addonDir);
+	if(dirMtime == -1)
+		return {};
+
+	int64_t indexDirMtime = -1;
+	std::vector<std::pair<std::string, AddonIndexEntry>> indexEntries;
+	if(load_index(indexFile, indexDirMtime, indexEntries) == false)
+		indexEntries.clear();
+
+	// Adding or removing an addon changes the modification time of the addon directory, so the addon directory only
+	// has to be listed if it differs from the one in the index
+	std::vector<std::string> addons;
+	outStats.indexValid = (indexDirMtime == dirMtime);
+	if(outStats.indexValid) {
+		addons.reserve(indexEntries.size());
+		for(auto &[name, entry] : indexEntries)
+			addons.push_back(name);
+	}
+	else
+		addons = listAddons();
+
+	std::unordered_map<std::string, AddonIndexEntry> cachedEntries {indexEntries.begin(), indexEntries.end()};
+	std::vector<std::pair<std::string, AddonIndexEntry>> entries;
+	entries.reserve(addons.size());
+	std::vector<std::string> matchingAddons;
+	for(auto &name : addons) {
+		auto addonPath = addonDir / name;
+		// The modification time of an addon only changes if its top-level entries change, which is all we're interested in
+		auto mtime = get_modification_time(addonPath);
+		if(mtime == -1)
+			continue;
+		auto it = cachedEntries.find(name);
+		AddonIndexEntry entry {};
+		if(it != cachedEntries.end() && it->second.mtime == mtime)
+			entry = it->second;
+		else {
+			entry.mtime = mtime;
+			entry.directories = get_top_level_directories(addonPath);
+			++outStats.numScanned;
+		}
+		auto matches = requiredDirectories.empty()
+		  || std::any_of(requiredDirectories.begin(), requiredDirectories.end(), [&entry](const std::string &dir) { return std::find(entry.directories.begin(), entry.directories.end(), dir) != entry.directories.end(); });
+		if(matches)
+			matchingAddons.push_back(name);
+		entries.push_back({name, std::move(entry)});
+	}
+	outStats.numAddons = static_cast<uint32_t>(entries.size());
+	outStats.numMatched = static_cast<uint32_t>(matchingAddons.size());
+	if(outStats.indexValid == false || outStats.numScanned > 0 || entries.size() != indexEntries.size())
+		save_index(indexFile, dirMtime, entries);
+	return matchingAddons;
+}
@@ -0,0 +1,29 @@
+#ifndef __RT_ADDON_INDEX_HPP__
+#define __RT_ADDON_INDEX_HPP__
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cinttypes>
+
+struct AddonIndexStats {
+	uint32_t numAddons = 0;
+	uint32_t numScanned = 0; // Addons that weren't in the index or have been modified since it was written
+	uint32_t numMatched = 0; // Addons that contain at least one of the required directories
+	bool indexValid = false; // Whether the list of addons could be taken from the index without listing the addon directory
+};
+
+// Returns the addons that contain at least one of the 'requiredDirectories' as a top-level directory, or all addons if
+// 'requiredDirectories' is empty. The addons and their top-level directories are cached in 'indexFile' together with the
+// modification times of the addon directories, so the addon directory only has to be listed again if an addon was added
+// or removed, and an addon is only inspected again if it has changed.
+// 'listAddons' is only called if the addon directory has changed since the index was written. The addons are returned
+// in the order of 'listAddons' (which is also the order in the index), so the mount order stays the same.
+// Only the modification times of the addon directory and of the addons themselves are compared, which only change if
+// entries are added to or removed from them. Changes further down (e.g. inside an addon's materials directory) don't
+// invalidate the index, which is fine as long as the top-level directories of an addon are all that's looked at.
+std::vector<std::string> find_addons(const std::filesystem::path &addonDir, const std::filesystem::path &indexFile, const std::function<std::vector<std::string>()> &listAddons, const std::vector<std::string> &requiredDirectories,
+  AddonIndexStats &outStats);
+
+#endif
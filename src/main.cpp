@@ -1,12 +1,17 @@
 #include <sharedutils/util_library.hpp>
 #include <sharedutils/util_path.hpp>
 #include <sharedutils/util.h>
+#include <sharedutils/util_string.h>
 #include <fsys/filesystem.h>
+#include <iostream>
+#include <chrono>
 #include <cassert>
+#include "addon_index.hpp"
 
 #pragma optimize("", off)
 int main(int argc, char *argv[])
 {
+	auto tStart = std::chrono::steady_clock::now();
 	auto programPath = util::Path::CreatePath(util::get_program_path());
 	programPath.PopBack(); // Go up from "bin" directory
 	auto strPath = programPath.GetString();
@@ -29,10 +34,28 @@ int main(int argc, char *argv[])
 	FileManager::SetAbsoluteRootPath(fileRootPath.GetString());
 
 	FileManager::AddCustomMountDirectory("materials");
-	std::vector<std::string> addons {};
-	FileManager::FindFiles("addons/*", nullptr, &addons);
+	// Every file lookup searches all mounted addons, so -mount_addons can be used to only mount the addons that contain
+	// specific top-level directories (e.g. "materials,models"). The addon index avoids listing the addons on every start.
+	std::vector<std::string> requiredAddonDirs {};
+	auto launchParams = util::get_launch_parameters(argc - 1, argv + 1);
+	auto itMountAddons = launchParams.find("-mount_addons");
+	if(itMountAddons != launchParams.end())
+		ustring::explode(itMountAddons->second, ",", requiredAddonDirs);
+	auto addonPath = fileRootPath;
+	addonPath += "addons/";
+	auto addonIndexPath = fileRootPath;
+	addonIndexPath += "cache/addon_index.txt";
+	AddonIndexStats addonStats {};
+	auto listAddons = []() {
+		std::vector<std::string> addons {};
+		FileManager::FindFiles("addons/*", nullptr, &addons);
+		return addons;
+	};
+	auto addons = find_addons(addonPath.GetString(), addonIndexPath.GetString(), listAddons, requiredAddonDirs, addonStats);
 	for(auto &addon : addons)
 		FileManager::AddCustomMountDirectory(("addons/" + addon).c_str());
+	auto tMount = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tStart);
+	std::cout << "Mounted " << addons.size() << " of " << addonStats.numAddons << " addons in " << tMount.count() << " ms (" << (addonStats.indexValid ? "cached index" : "index rebuilt") << ", " << addonStats.numScanned << " addons scanned)." << std::endl;
 
 	std::string err;
 	auto lib = util::Library::Load(libPath.GetString(), {path.GetString()}, &err);
@@ -45,11 +68,13 @@ int main(int argc, char *argv[])
 		std::cout << "Unable to locate symbol address for 'render_raytracing' in library '" << libPath.GetString() << "'!" << std::endl;
 		return EXIT_FAILURE;
 	}
+	auto tStartup = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - tStart);
+	std::cout << "Startup took " << tStartup.count() << " ms." << std::endl;
 	auto result = f(argc, argv);
 
 	// TODO: We'll force an exit, since doing a clean exit causes it to permanently freeze
 	// Fix this issue!
-	exit(EXIT_SUCCESS);
+	exit(result);
 	lib = nullptr;
 	return result;
 }